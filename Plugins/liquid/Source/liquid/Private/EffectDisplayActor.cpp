@@ -5,11 +5,17 @@
 #include "NiagaraSystem.h"
 #include "NiagaraFunctionLibrary.h"
 #include "NiagaraSystemInstanceController.h"
-#include "AssetRegistry/AssetRegistryModule.h"
-#include "AssetRegistry/IAssetRegistry.h"
+#include "NiagaraTypes.h"
 #include "Engine/AssetManager.h"
 #include "Engine/StreamableManager.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "LiquidStats.h"
+#include "EffectDisplayCapture.h"
+#include "EffectPlaylistDiscovery.h"
+#include "EngineUtils.h"
+#include "Misc/App.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
 
 #if WITH_EDITOR
 #include "Kismet/KismetArrayLibrary.h"
@@ -34,79 +40,253 @@ AEffectDisplayActor::AEffectDisplayActor()
 
 void AEffectDisplayActor::BeginLoadAsync()
 {
-	if (!AdditionalNiagaraFolderPath.IsEmpty())
+	LoadStartTime = FPlatformTime::Seconds();
+	PlaylistLoadSeconds = -1.0f;
+	PlaylistDiscoverySeconds = -1.0f;
+	if (AdditionalNiagaraFolderPath.IsEmpty())
 	{
-		const FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry");
-		const IAssetRegistry& AssetRegistry = AssetRegistryModule.Get();
-
-		FARFilter Filter;
-		Filter.PackagePaths.Add(*AdditionalNiagaraFolderPath);
-		Filter.bRecursivePaths = true;
-		Filter.bIncludeOnlyOnDiskAssets = false;
-		Filter.ClassPaths.Add(UNiagaraSystem::StaticClass()->GetClassPathName());
-
-		// アセットの検索
-		TArray<FAssetData> NiagaraAssetArray{};
-		NiagaraAssetArray.Reserve(PlaylistReserveCapacity);
-		AssetRegistry.GetAssets(Filter, NiagaraAssetArray);
+		OnPlaylistReady();
+		return;
+	}
+	//note: フォルダの検索は非同期 (キャッシュ済みの場合は DiscoverAsync 内でコールバックが呼ばれる)
+	bDiscoveringPlaylist = true;
+	const TWeakObjectPtr<AEffectDisplayActor> Self(this);
+	DiscoveryCallbackID = FEffectPlaylistDiscovery::Get().DiscoverAsync(AdditionalNiagaraFolderPath,
+		[Self](const TArray<FEffectPlaylistAsset>& Assets)
+		{
+			if (!Self.IsValid()) { return; }
+			AEffectDisplayActor& Actor = *Self.Get();
+			Actor.DiscoveryCallbackID = 0;
+			Actor.PlaylistDiscoverySeconds = static_cast<float>(FPlatformTime::Seconds() - Actor.LoadStartTime);
+			Actor.AddDiscoveredAssets(Assets);
+			Actor.OnPlaylistReady();
+		});
+}
 
-		if(NiagaraAssetArray.IsEmpty())
+/**
+ * @details
+ * 絞り込み・並び替えはフォルダから追加したエフェクトのみが対象で、Playlist に直接指定したエフェクトの順番は変えない。
+ */
+void AEffectDisplayActor::AddDiscoveredAssets(const TArray<FEffectPlaylistAsset>& Assets)
+{
+	const int64 MaxBytes = static_cast<int64>(MaxPlaylistAssetKilobytes) * 1024;
+	TArray<const FEffectPlaylistAsset*> Filtered;
+	Filtered.Reserve(Assets.Num());
+	for (const FEffectPlaylistAsset& Asset : Assets)
+	{
+		if (MaxBytes > 0 && Asset.DiskSize > MaxBytes)
+		{
+			continue;
+		}
+		bool bMatched = true;
+		for (const TPair<FName, FString>& Tag : PlaylistTagFilter)
 		{
-			UE_LOG(LogTemp, Log,TEXT("not found niagara system in %s "), *AdditionalNiagaraFolderPath);
+			FString Value;
+			if (!Asset.AssetData.GetTagValue(Tag.Key, Value) || (!Tag.Value.IsEmpty() && Value != Tag.Value))
+			{
+				bMatched = false;
+				break;
+			}
 		}
-		for(const auto& Asset : NiagaraAssetArray)
+		if (bMatched)
 		{
-			TSoftObjectPtr<UNiagaraSystem> SoftPtr(Asset.ToSoftObjectPath());
-			Playlist.Add(SoftPtr);	
+			Filtered.Add(&Asset);
 		}
 	}
-	LoadNiagaraSystemAsync();
+
+	switch (PlaylistSortMode)
+	{
+	case EEffectPlaylistSortMode::Name:
+		Filtered.StableSort([](const FEffectPlaylistAsset& A, const FEffectPlaylistAsset& B)
+		{
+			return A.AssetData.AssetName.LexicalLess(B.AssetData.AssetName);
+		});
+		break;
+	case EEffectPlaylistSortMode::SizeAscending:
+		Filtered.StableSort([](const FEffectPlaylistAsset& A, const FEffectPlaylistAsset& B)
+		{
+			return A.DiskSize < B.DiskSize;
+		});
+		break;
+	case EEffectPlaylistSortMode::SizeDescending:
+		Filtered.StableSort([](const FEffectPlaylistAsset& A, const FEffectPlaylistAsset& B)
+		{
+			return A.DiskSize > B.DiskSize;
+		});
+		break;
+	default:
+		break;
+	}
+
+	if (Filtered.IsEmpty())
+	{
+		UE_LOG(LogTemp, Log,TEXT("not found niagara system in %s "), *AdditionalNiagaraFolderPath);
+	}
+	Playlist.Reserve(Playlist.Num() + Filtered.Num());
+	for (const FEffectPlaylistAsset* Asset : Filtered)
+	{
+		TSoftObjectPtr<UNiagaraSystem> SoftPtr(Asset->AssetData.ToSoftObjectPath());
+		Playlist.Add(SoftPtr);
+	}
+	UE_LOG(LogTemp, Log, TEXT("[AEffectDisplayActor] Added %d/%d Niagara systems from %s (%.3f sec)"),
+		Filtered.Num(), Assets.Num(), *AdditionalNiagaraFolderPath, PlaylistDiscoverySeconds);
 }
 
-void AEffectDisplayActor::LoadNiagaraSystemAsync()
+void AEffectDisplayActor::OnPlaylistReady()
 {
-	if (!Playlist.IsValidIndex(CurrentLoadingIndex))
+	bDiscoveringPlaylist = false;
+	EntryStates.Init(EPlaylistEntryState::Unloaded, Playlist.Num());
+	//note: ロードするものが無いので、ロード済み(=再生終了)として扱う (キャプチャモードが終了できるように)
+	if (Playlist.IsEmpty())
 	{
+		PlaylistLoadSeconds = static_cast<float>(FPlatformTime::Seconds() - LoadStartTime);
+		UE_LOG(LogTemp, Error, TEXT("[AEffectDisplayActor] %s has no playable Niagara system. (Folder: %s)"),
+			*GetName(), *AdditionalNiagaraFolderPath);
 		return;
 	}
-	FStreamableManager& Manager = UAssetManager::GetStreamableManager();
-	auto& SoftPtr = Playlist[CurrentLoadingIndex];
+	UpdateLookAhead();
+}
+
+/**
+ * @details
+ * - 再生位置から LookAheadCount 個(スロット数より少ない場合はスロット数)先までの未ロードのエントリを1つのリクエストでまとめてロードする
+ * - 再生位置から KeepBehindCount 個より後ろにあるエントリは参照を外し、GC で解放されるようにする
+ * - ロード中のリクエストがある場合は完了時に再度呼ばれる
+ */
+void AEffectDisplayActor::UpdateLookAhead()
+{
+	if (bDiscoveringPlaylist || PlaylistBatch.IsLoading() || Playlist.IsEmpty())
+	{
+		return;
+	}
+	//再生位置から先読みするエントリ (ロードに失敗したものは除く)
+	TArray<int32, TInlineAllocator<16>> AheadIndices;
+	int32 AheadIndex = CurrentPlayIndex;
+	//note: 全スロットが同時に次のエントリを要求できるよう、少なくともスロット数分は先読みする
+	const int32 NumAhead = FMath::Max3(LookAheadCount, Slots.Num(), 1);
+	for (int32 Count = 0; Count < NumAhead; ++Count)
+	{
+		AheadIndex = GetNextPlayIndex(AheadIndex);
+		if (AheadIndex == InvalidPlayIndex || AheadIndices.Contains(AheadIndex))
+		{
+			break;
+		}
+		AheadIndices.Add(AheadIndex);
+	}
+
+	//再生位置から離れたエントリを解放
+	for (auto It = LoadedPlayList.CreateIterator(); It; ++It)
+	{
+		const int32 LoadedIndex = It.Key();
+		const bool bPlaying = Slots.ContainsByPredicate([LoadedIndex](const FEffectDisplaySlot& Slot) { return Slot.PlayIndex == LoadedIndex; });
+		if (bPlaying || LoadedIndex == CurrentPlayIndex || AheadIndices.Contains(LoadedIndex))
+		{
+			continue;
+		}
+		const int32 BehindCount = CurrentPlayIndex == InvalidPlayIndex
+			? Playlist.Num()
+			: (CurrentPlayIndex - LoadedIndex + Playlist.Num()) % Playlist.Num();
+		if (BehindCount <= KeepBehindCount)
+		{
+			continue;
+		}
+		UE_LOG(LogTemp, Verbose, TEXT("[AEffectDisplayActor] Unload Niagara %s"), *Playlist[LoadedIndex].ToString());
+		It.RemoveCurrent();
+		LoadedPlayListBundles.Remove(LoadedIndex);
+		EntryStates[LoadedIndex] = EPlaylistEntryState::Unloaded;
+	}
+
+	LoadingIndices.Reset();
+	TArray<TSoftObjectPtr<UNiagaraSystem>> SoftPtrs;
+	for (const int32 Index : AheadIndices)
+	{
+		if (EntryStates[Index] == EPlaylistEntryState::Unloaded)
+		{
+			EntryStates[Index] = EPlaylistEntryState::Loading;
+			LoadingIndices.Add(Index);
+			SoftPtrs.Add(Playlist[Index]);
+		}
+	}
+	if (SoftPtrs.IsEmpty())
+	{
+		return;
+	}
+
+	PlaylistBatch.SetSoftPtrs(SoftPtrs);
 	const TWeakObjectPtr<AEffectDisplayActor> Self(this);
-	CurrentLoadingHandle = Manager.RequestAsyncLoad(
-	SoftPtr.ToSoftObjectPath(),
-		FStreamableDelegate::CreateLambda([Self]()
+	PlaylistBatch.LoadAsync(
+		[Self](int32 Index, UNiagaraSystem* LoadedNiagara)
 		{
 			if (!Self.IsValid()) { return; }
 			AEffectDisplayActor& Actor = *Self.Get();
-			auto& SoftPtr = Actor.Playlist[Actor.CurrentLoadingIndex];
-			UNiagaraSystem* LoadedNiagara =  Actor.Playlist[Actor.CurrentLoadingIndex].Get();
-			const bool IsSuccess = Actor.Playlist[Actor.CurrentLoadingIndex].IsValid() && LoadedNiagara != nullptr;
-			if (!IsSuccess)
-			{
-				UE_LOG(LogTemp, Warning,
-				TEXT("[AEffectDisplayActor] Retry Load : %s"), *SoftPtr.ToSoftObjectPath().ToString());
-				Actor.LoadNiagaraSystemAsync();
-				return;
-			}
-			
+			const int32 PlaylistIndex = Actor.LoadingIndices[Index];
+			const FString Path = Actor.Playlist[PlaylistIndex].ToSoftObjectPath().ToString();
 			if (LoadedNiagara)
 			{
-				Actor.LoadedPlayList.Add(LoadedNiagara);
+				Actor.EntryStates[PlaylistIndex] = EPlaylistEntryState::Loaded;
+				Actor.LoadedPlayList.Add(PlaylistIndex, LoadedNiagara);
+				FLiquidEffectBundle& Bundle = Actor.LoadedPlayListBundles.Add(PlaylistIndex);
+				Bundle.AddNiagaraSystem(LoadedNiagara);
 				UE_LOG(LogTemp, Log,
-				   TEXT("[AEffectDisplayActor::LoadNiagaraSystemAsync] Loaded Niagara %s"), *SoftPtr.ToSoftObjectPath().ToString());
+				   TEXT("[AEffectDisplayActor::UpdateLookAhead] Loaded Niagara %s %s"), *Path, *Bundle.ToString());
+				//次に再生するエフェクトは再生開始までに Mip を揃えておく
+				if (PlaylistIndex == Actor.GetNextPlayIndex(Actor.CurrentPlayIndex))
+				{
+					Actor.RequestNextEffectTextureMips();
+				}
 			}
 			else
 			{
+				//リトライしても失敗したエントリは以降の再生・先読みから除外する
+				Actor.EntryStates[PlaylistIndex] = EPlaylistEntryState::Failed;
 				UE_LOG(LogTemp, Error,
-				   TEXT("[AEffectDisplayActor::LoadNiagaraSystemAsync] Failed to load Niagara %s"),
-				   *SoftPtr.ToSoftObjectPath().ToString());
+				   TEXT("[AEffectDisplayActor::UpdateLookAhead] Failed to load Niagara %s. Skipped."), *Path);
+				if (Actor.Capture.IsValid())
+				{
+					Actor.Capture->AddFailedEntry(Path);
+				}
 			}
-			Actor.CurrentLoadingIndex++;
-			if (Actor.CurrentLoadingIndex < Actor.Playlist.Num())
+		},
+		[Self](int32 NumLoaded, int32 NumFailed)
+		{
+			if (!Self.IsValid()) { return; }
+			AEffectDisplayActor& Actor = *Self.Get();
+			if (!Actor.IsPlaylistLoaded())
+			{
+				Actor.PlaylistLoadSeconds = static_cast<float>(FPlatformTime::Seconds() - Actor.LoadStartTime);
+				UE_LOG(LogTemp, Log,
+					TEXT("[AEffectDisplayActor] Playlist Loaded. Num: %d Failed: %d Time: %.3f sec (Playlist: %d LookAhead: %d)"),
+					NumLoaded, NumFailed, Actor.PlaylistLoadSeconds, Actor.Playlist.Num(), Actor.LookAheadCount);
+			}
+			//ロード中に再生位置が進んでいる場合に備えて先読み範囲を更新する
+			Actor.UpdateLookAhead();
+		},
+		MaxLoadRetryCount);
+}
+
+/**
+ * @return FromIndex の次に再生するエントリ。ロードに失敗したものは飛ばす。(再生できるものが無い場合は InvalidPlayIndex)
+ */
+int32 AEffectDisplayActor::GetNextPlayIndex(int32 FromIndex) const
+{
+	const int32 Num = Playlist.Num();
+	for (int32 Step = 1; Step <= Num; ++Step)
+	{
+		int32 Index = FromIndex + Step;
+		if (Index >= Num)
+		{
+			if (!IsLoop)
 			{
-				Actor.LoadNiagaraSystemAsync();
+				return InvalidPlayIndex;
 			}
-		}));
+			Index %= Num;
+		}
+		if (EntryStates[Index] != EPlaylistEntryState::Failed)
+		{
+			return Index;
+		}
+	}
+	return InvalidPlayIndex;
 }
 
 void AEffectDisplayActor::BeginPlay()
@@ -121,6 +301,17 @@ void AEffectDisplayActor::BeginPlay()
 	const FVector Radius(RotationRadius,.0,.0);
 	PlaceRoot->SetWorldLocation(RotateLocation + Radius);
 	
+	//キャプチャモードはプレイリストを1周して終了する
+	if (bCaptureMode || FParse::Param(FCommandLine::Get(), TEXT("LiquidEffectCapture")))
+	{
+		bCaptureMode = true;
+		IsLoop = false;
+		Capture = MakeShared<FEffectDisplayCapture>();
+		//note: そのフレームの Niagara の更新が終わってからパーティクル数を読む
+		SetTickGroup(TG_LastDemotable);
+	}
+	CreateSlots();
+
 	//初期値が無効になっているものがあれば取り除く
 	Playlist.RemoveAll([](const TSoftObjectPtr<UNiagaraSystem>& System)
 	{
@@ -129,33 +320,100 @@ void AEffectDisplayActor::BeginPlay()
 	BeginLoadAsync();
 }
 
-void AEffectDisplayActor::Destroyed()
+/**
+ * @details
+ * スロットが1つの場合は PlaceRoot をそのまま使用し、複数の場合は PlaceRoot を中心としたグリッド状に配置位置を生成する。
+ * (列は右方向、行は前方向に並べる)
+ */
+void AEffectDisplayActor::CreateSlots()
 {
-	Super::Destroyed();
-	if (CurrentLoadingHandle.IsValid())
+	const int32 Columns = FMath::Max(GridColumns, 1);
+	const int32 Rows = FMath::Max(GridRows, 1);
+	//note: キャプチャモードはフレーム全体の負荷をエントリ毎に計測するため、同時に再生するのは1スロットのみ
+	if (bCaptureMode && Columns * Rows > 1)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("[AEffectDisplayActor] Grid is ignored in capture mode. Use InstancesPerSlot to measure scaling."));
+	}
+	const int32 NumSlots = bCaptureMode ? 1 : Columns * Rows;
+	Slots.SetNum(NumSlots);
+	if (NumSlots == 1)
 	{
-		CurrentLoadingHandle->CancelHandle();
+		Slots[0].PlaceRoot = PlaceRoot;
+		return;
+	}
+	for (int32 SlotIndex = 0; SlotIndex < NumSlots; ++SlotIndex)
+	{
+		const float Column = static_cast<float>(SlotIndex % Columns) - (Columns - 1) * .5f;
+		const float Row = static_cast<float>(SlotIndex / Columns) - (Rows - 1) * .5f;
+		USceneComponent* SlotRoot = NewObject<USceneComponent>(this, *FString::Printf(TEXT("SlotRoot_%d"), SlotIndex));
+		SlotRoot->SetupAttachment(PlaceRoot);
+		SlotRoot->SetRelativeLocation(FVector(Row * GridSpacing.X, Column * GridSpacing.Y, .0));
+		SlotRoot->RegisterComponent();
+		Slots[SlotIndex].PlaceRoot = SlotRoot;
 	}
 }
 
-bool AEffectDisplayActor::ShouldStartNextEffect() 
+void AEffectDisplayActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	//note: プールのコンポーネントは World が所有しているため、アクターと一緒には破棄されない
+	for (FEffectDisplaySlot& Slot : Slots)
+	{
+		StopSlot(Slot);
+	}
+	Super::EndPlay(EndPlayReason);
+}
+
+void AEffectDisplayActor::Destroyed()
 {
-	//再生中のエフェクトがある
-	if (NiagaraComponent)
+	Super::Destroyed();
+	PlaylistBatch.Cancel();
+	FEffectPlaylistDiscovery::Get().CancelCallback(AdditionalNiagaraFolderPath, DiscoveryCallbackID);
+	DiscoveryCallbackID = 0;
+}
+
+bool AEffectDisplayActor::ShouldStartNextEffect(int32& OutNextIndex)
+{
+	OutNextIndex = InvalidPlayIndex;
+	//フォルダの検索中はプレイリストが確定していない
+	if (bDiscoveringPlaylist)
+	{
 		return false;
-	//ロードが終わっていない
-	if (CurrentPlayIndex >= LoadedPlayList.Num())
+	}
+	//ループしない場合の終端、または再生できるエントリが無い
+	OutNextIndex = GetNextPlayIndex(CurrentPlayIndex);
+	if (OutNextIndex == InvalidPlayIndex)
 	{
+		const bool bAnyPlaying = Slots.ContainsByPredicate([](const FEffectDisplaySlot& Slot) { return Slot.IsPlaying(); });
+		if (!bPlaylistFinished && !bAnyPlaying && (CurrentPlayIndex != InvalidPlayIndex || IsPlaylistLoaded()))
+		{
+			bPlaylistFinished = true;
+			UE_LOG(LogTemp, Log,TEXT("AEffectDisplayActor Finish Play Effect"));
+			if (Capture.IsValid())
+			{
+				FinishCapture();
+			}
+		}
 		return false;
 	}
-	//ループの最終判定
-	if (CurrentPlayIndex  == Playlist.Num() - 1 && !IsLoop)
+	//先読みが追いついていない場合はロードを待つ
+	if (EntryStates[OutNextIndex] != EPlaylistEntryState::Loaded)
 	{
+		UpdateLookAhead();
 		return false;
 	}
-	if (CurrentPlayIndex  == Playlist.Num() - 1 && IsLoop)
+	//キャプチャモードでは最初のエフェクトを再生する前にベースラインを計測する
+	if (Capture.IsValid() && CurrentPlayIndex == InvalidPlayIndex)
 	{
-		CurrentPlayIndex = InvalidPlayIndex;
+		const double Now = FPlatformTime::Seconds();
+		if (CaptureBaselineEndTime <= .0)
+		{
+			CaptureBaselineEndTime = Now + CaptureBaselineSeconds;
+		}
+		if (Now < CaptureBaselineEndTime)
+		{
+			Capture->SampleBaseline();
+			return false;
+		}
 	}
 	return true;
 }
@@ -164,90 +422,218 @@ void AEffectDisplayActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	if (IsValid(NiagaraComponent))
+	bool bAnyPlaying = false;
+	for (FEffectDisplaySlot& Slot : Slots)
+	{
+		TickSlot(Slot);
+		bAnyPlaying |= Slot.IsPlaying();
+	}
+	if (bAnyPlaying && !FMath::IsNearlyZero(RotateSpeed))
 	{
-		if (!NiagaraComponent->IsActive())
+		//note: UserParameter モードではシステム側で回転するので、Transform を更新せずに角度だけ進める
+		if (OrbitMode == EEffectDisplayOrbitMode::Transform)
 		{
-			//一旦次フレームで再生判定を行う
-			StopCurrentPlayEffect();
-			return;
+			RotationNiagaraSystem(DeltaTime);
 		}
-		
-		RotationNiagaraSystem(DeltaTime);
-		const auto NiagaraSystem = NiagaraComponent->GetAsset();
-		if(!NiagaraSystem)
+		else
 		{
-			UE_LOG(LogTemp, VeryVerbose, TEXT("AEffectDisplayActor::Tick NiagaraSystem is nullptr"));
-			return;
+			OrbitAngle = FMath::Fmod(OrbitAngle + RotateSpeed * DeltaTime, 360.0f);
 		}
-		
-		const auto SystemInstanceController = NiagaraComponent->GetSystemInstanceController();
-		if(!SystemInstanceController.IsValid())
+	}
+	//空いたスロットで次のエントリを再生する (各スロットは個別に再生時間を計る)
+	for (FEffectDisplaySlot& Slot : Slots)
+	{
+		if (Slot.IsPlaying())
 		{
-			UE_LOG(LogTemp, Log,TEXT("AEffectDisplayActor::Tick SystemInstanceController Invalid"));
-			return;
+			continue;
 		}
-		const auto CurrentAge =SystemInstanceController->GetAge();
-		if(CurrentAge >= PlayInterval)
+		int32 NextIndex = InvalidPlayIndex;
+		if (!ShouldStartNextEffect(NextIndex) || !PlayNext(Slot, NextIndex))
 		{
-			StopCurrentPlayEffect();
+			break;
 		}
 	}
-	if (ShouldStartNextEffect())
+}
+
+void AEffectDisplayActor::TickSlot(FEffectDisplaySlot& Slot)
+{
+	if (!Slot.IsPlaying())
+	{
+		return;
+	}
+	//note: 再生時間・初回フレームは最初のインスタンスで判定する
+	UNiagaraComponent* NiagaraComponent = Slot.Components[0];
+	if (!IsValid(NiagaraComponent) || !NiagaraComponent->IsActive())
+	{
+		//空いたスロットとして次のエントリの再生判定を行う
+		StopSlot(Slot);
+		return;
+	}
+	if (Slot.bWaitingFirstFrame)
+	{
+		RecordFirstFrame(Slot);
+	}
+	if (Capture.IsValid())
+	{
+		Capture->SampleEntry(Slot.Components);
+	}
+	const auto NiagaraSystem = NiagaraComponent->GetAsset();
+	if(!NiagaraSystem)
+	{
+		UE_LOG(LogTemp, VeryVerbose, TEXT("AEffectDisplayActor::Tick NiagaraSystem is nullptr"));
+		return;
+	}
+	
+	const auto SystemInstanceController = NiagaraComponent->GetSystemInstanceController();
+	if(!SystemInstanceController.IsValid())
+	{
+		UE_LOG(LogTemp, Log,TEXT("AEffectDisplayActor::Tick SystemInstanceController Invalid"));
+		return;
+	}
+	const auto CurrentAge =SystemInstanceController->GetAge();
+	if(CurrentAge >= PlayInterval)
 	{
-		PlayNext();
+		StopSlot(Slot);
 	}
 }
 
-void AEffectDisplayActor::StopCurrentPlayEffect()
+void AEffectDisplayActor::StopSlot(FEffectDisplaySlot& Slot)
 {
-	if (NiagaraComponent && NiagaraComponent->IsActive())
+	Slot.bWaitingFirstFrame = false;
+	if (!Slot.IsPlaying())
 	{
-		NiagaraComponent->DeactivateImmediate();
+		return;
+	}
+	if (Capture.IsValid())
+	{
+		Capture->EndEntry(Slot.SpawnMs, Slot.FirstFrameMs);
 	}
-	if (NiagaraComponent)
+	SCOPE_CYCLE_COUNTER(STAT_LiquidDisplayRelease);
+	for (UNiagaraComponent* NiagaraComponent : Slot.Components)
 	{
-		NiagaraComponent->DestroyComponent(); 
-		NiagaraComponent = nullptr;
+		if (!NiagaraComponent)
+		{
+			continue;
+		}
+		const double ReleaseStartTime = FPlatformTime::Seconds();
+		const FName SystemName = GetFNameSafe(NiagaraComponent->GetAsset());
+		if (NiagaraComponent->IsActive())
+		{
+			NiagaraComponent->DeactivateImmediate();
+		}
+		//プールから取得したコンポーネントはプールへ返却する (プールが無効な場合は ReleaseToPool 内で破棄される)
+		if (NiagaraComponent->PoolingMethod == ENCPoolMethod::ManualRelease)
+		{
+			NiagaraComponent->ReleaseToPool();
+		}
+		else
+		{
+			NiagaraComponent->DestroyComponent();
+		}
+
+		const double ReleaseMs = (FPlatformTime::Seconds() - ReleaseStartTime) * 1000.0;
+		FEffectDisplaySpawnStats& Stats = SpawnStats.FindOrAdd(SystemName);
+		Stats.TotalReleaseMs += ReleaseMs;
+		Stats.MaxReleaseMs = FMath::Max(Stats.MaxReleaseMs, ReleaseMs);
 	}
+	Slot.Components.Reset();
+	Slot.PlayIndex = InvalidPlayIndex;
 }
 
-bool AEffectDisplayActor::PlayNext()
+bool AEffectDisplayActor::PlayNext(FEffectDisplaySlot& Slot, int32 NextIndex)
 {
-	if (LoadedPlayList.IsEmpty())
+	UNiagaraSystem* PlaySystem = LoadedPlayList.FindRef(NextIndex);
+	if (!PlaySystem)
 	{
 		return false;
 	}
-	CurrentPlayIndex++;
-	if(CurrentPlayIndex >= LoadedPlayList.Num())
+	//先頭に戻った
+	if (NextIndex <= CurrentPlayIndex)
 	{
-		if(IsLoop)
+		const FEffectDisplaySpawnStats Total = GetTotalSpawnStats();
+		UE_LOG(LogTemp, Log,
+			TEXT("[AEffectDisplayActor] Playlist Looped. Spawns: %d PoolHit: %.0f%% Spawn: %.3f ms (Max %.3f) Release: %.3f ms (Max %.3f) FirstFrame: %.3f ms (Max %.3f)"),
+			Total.NumSpawns, Total.GetPoolHitRate() * 100.0f,
+			Total.GetAverageSpawnMs(), Total.MaxSpawnMs,
+			Total.GetAverageReleaseMs(), Total.MaxReleaseMs,
+			Total.GetAverageFirstFrameMs(), Total.MaxFirstFrameMs);
+	}
+	CurrentPlayIndex = NextIndex;
+	Slot.PlayIndex = NextIndex;
+	//再生位置が進んだので、後ろのエントリを解放して先を読み込む
+	UpdateLookAhead();
+
+	FEffectDisplaySpawnStats& Stats = SpawnStats.FindOrAdd(PlaySystem->GetFName());
+	Slot.SpawnStartTime = FPlatformTime::Seconds();
+	const int32 NumInstances = FMath::Max(InstancesPerSlot, 1);
+	for (int32 InstanceIndex = 0; InstanceIndex < NumInstances; ++InstanceIndex)
+	{
+		const double InstanceStartTime = FPlatformTime::Seconds();
+		UNiagaraComponent* NiagaraComponent = nullptr;
 		{
-			CurrentPlayIndex = 0;
+			SCOPE_CYCLE_COUNTER(STAT_LiquidDisplaySpawn);
+			//note: プール使用時は停止時に ReleaseToPool で返却するため自動破棄しない
+			NiagaraComponent = UNiagaraFunctionLibrary::SpawnSystemAttached(
+				PlaySystem,
+				Slot.PlaceRoot,
+				NAME_None,
+				InstanceOffset * InstanceIndex,
+				FRotator::ZeroRotator,
+				EAttachLocation::KeepRelativeOffset,
+				!bUseComponentPool,
+				true,
+				bUseComponentPool ? ENCPoolMethod::ManualRelease : ENCPoolMethod::None);
 		}
-		else
+		if (!NiagaraComponent)
 		{
-			CurrentPlayIndex = InvalidPlayIndex;
-			UE_LOG(LogTemp, Log,TEXT("AEffectDisplayActor Finish Play Effect"));
-			return false;
+			continue;
+		}
+		Slot.Components.Add(NiagaraComponent);
+		SetOrbitParameters(NiagaraComponent);
+		const double InstanceSpawnMs = (FPlatformTime::Seconds() - InstanceStartTime) * 1000.0;
+		++Stats.NumSpawns;
+		Stats.TotalSpawnMs += InstanceSpawnMs;
+		Stats.MaxSpawnMs = FMath::Max(Stats.MaxSpawnMs, InstanceSpawnMs);
+		bool bReused = false;
+		SpawnedComponents.Add(NiagaraComponent, &bReused);
+		if (bReused)
+		{
+			++Stats.NumPoolHits;
+		}
+		else if (SpawnedComponents.Num() > PlaylistReserveCapacity)
+		{
+			//破棄されたコンポーネントを取り除く
+			for (auto It = SpawnedComponents.CreateIterator(); It; ++It)
+			{
+				if (!It->IsValid())
+				{
+					It.RemoveCurrent();
+				}
+			}
 		}
 	}
-	UNiagaraSystem* PlaySystem = LoadedPlayList[CurrentPlayIndex];
-	NiagaraComponent = UNiagaraFunctionLibrary::SpawnSystemAttached(
-		PlaySystem,
-		PlaceRoot,
-		NAME_None,
-		FVector::Zero(),
-		FRotator::ZeroRotator,
-		EAttachLocation::KeepRelativeOffset,
-		true,
-		true);
-	if(!NiagaraComponent)
+	if(Slot.Components.IsEmpty())
 	{
 		UE_LOG(LogTemp, Log,TEXT("AEffectDisplayActor Finish Play Effect"));
+		Slot.PlayIndex = InvalidPlayIndex;
 		return false;
 	}
-	NiagaraComponent->SetAutoDestroy(true);
+	//note: K インスタンス分の Spawn 時間 (インスタンス数に対するスケールの計測用)
+	const double SpawnMs = (FPlatformTime::Seconds() - Slot.SpawnStartTime) * 1000.0;
+	Slot.SpawnMs = SpawnMs;
+	Slot.FirstFrameMs = -1.0;
+	if (Capture.IsValid())
+	{
+		const FLiquidEffectBundle* Bundle = LoadedPlayListBundles.Find(NextIndex);
+		Capture->BeginEntry(PlaySystem, Bundle ? Bundle->GetTotalBytes() : 0, Slot.Components.Num());
+	}
+	Slot.bWaitingFirstFrame = true;
+	RequestNextEffectTextureMips();
+#if CSV_PROFILER
+	//note: ビルド間で差分を取れるよう、システム毎の列として記録する
+	FCsvProfiler::RecordCustomStat(FName(*FString::Printf(TEXT("Spawn/%s"), *PlaySystem->GetName())), CSV_CATEGORY_INDEX(Liquid), static_cast<float>(SpawnMs), ECsvCustomStatOp::Set);
+	CSV_EVENT(Liquid, TEXT("Spawn %s"), *PlaySystem->GetName());
+#endif
 
 #if WITH_EDITOR
 	UKismetSystemLibrary::PrintString(
@@ -264,6 +650,85 @@ bool AEffectDisplayActor::PlayNext()
 	return true;
 }
 
+/**
+ * @details
+ * 再生中のエフェクトは再生時間の間、次に再生するエフェクトは再生開始まで(再生時間の2倍)の間、テクスチャの全Mipを常駐させる。
+ */
+void AEffectDisplayActor::RequestNextEffectTextureMips() const
+{
+	if (!bPreloadTextureMips || LoadedPlayListBundles.IsEmpty())
+	{
+		return;
+	}
+	for (const FEffectDisplaySlot& Slot : Slots)
+	{
+		if (const FLiquidEffectBundle* CurrentBundle = LoadedPlayListBundles.Find(Slot.PlayIndex))
+		{
+			CurrentBundle->RequestTextureMips(PlayInterval);
+		}
+	}
+	const int32 NextIndex = GetNextPlayIndex(CurrentPlayIndex);
+	if (const FLiquidEffectBundle* NextBundle = LoadedPlayListBundles.Find(NextIndex); NextBundle && NextIndex != CurrentPlayIndex)
+	{
+		NextBundle->RequestTextureMips(PlayInterval * 2.0f);
+	}
+}
+
+FEffectDisplaySpawnStats AEffectDisplayActor::GetTotalSpawnStats() const
+{
+	FEffectDisplaySpawnStats Total;
+	for (const TPair<FName, FEffectDisplaySpawnStats>& Pair : SpawnStats)
+	{
+		Total.Accumulate(Pair.Value);
+	}
+	return Total;
+}
+
+void AEffectDisplayActor::RecordFirstFrame(FEffectDisplaySlot& Slot)
+{
+	const UNiagaraComponent* NiagaraComponent = Slot.Components[0];
+	const auto SystemInstanceController = NiagaraComponent->GetSystemInstanceController();
+	if (!SystemInstanceController.IsValid() || SystemInstanceController->GetAge() <= .0f)
+	{
+		return;
+	}
+	Slot.bWaitingFirstFrame = false;
+	const UNiagaraSystem* NiagaraSystem = NiagaraComponent->GetAsset();
+	const double FirstFrameMs = (FPlatformTime::Seconds() - Slot.SpawnStartTime) * 1000.0;
+	Slot.FirstFrameMs = FirstFrameMs;
+	FEffectDisplaySpawnStats& Stats = SpawnStats.FindOrAdd(GetFNameSafe(NiagaraSystem));
+	++Stats.NumFirstFrames;
+	Stats.TotalFirstFrameMs += FirstFrameMs;
+	Stats.MaxFirstFrameMs = FMath::Max(Stats.MaxFirstFrameMs, FirstFrameMs);
+#if CSV_PROFILER
+	FCsvProfiler::RecordCustomStat(FName(*FString::Printf(TEXT("FirstFrame/%s"), *GetNameSafe(NiagaraSystem))), CSV_CATEGORY_INDEX(Liquid), static_cast<float>(FirstFrameMs), ECsvCustomStatOp::Set);
+#endif
+}
+
+void AEffectDisplayActor::FinishCapture()
+{
+	const FString ReportName = FString::Printf(TEXT("%s_%s"), *UWorld::RemovePIEPrefix(GetWorld()->GetMapName()), *GetName());
+	const FString ReportPath = Capture->WriteReport(ReportName);
+	bCaptureFinished = true;
+	//空のプレイリストは計測結果が無いので失敗とする
+	bCaptureSucceeded = !ReportPath.IsEmpty() && !Playlist.IsEmpty();
+	UE_LOG(LogTemp, Display, TEXT("[AEffectDisplayActor] Capture Finished. Report: %s"), *ReportPath);
+	if (!FApp::IsUnattended())
+	{
+		return;
+	}
+	bool bAllSucceeded = true;
+	for (TActorIterator<AEffectDisplayActor> It(GetWorld()); It; ++It)
+	{
+		if (It->bCaptureMode && !It->bCaptureFinished)
+		{
+			return;
+		}
+		bAllSucceeded &= !It->bCaptureMode || It->bCaptureSucceeded;
+	}
+	FPlatformMisc::RequestExitWithStatus(false, bAllSucceeded ? 0 : 1);
+}
+
 void AEffectDisplayActor::RotationNiagaraSystem(float DeltaTime)const
 {
 	FRotator CurrentRotation = RotationRoot->GetRelativeRotation();
@@ -271,4 +736,38 @@ void AEffectDisplayActor::RotationNiagaraSystem(float DeltaTime)const
 	RotationRoot->SetRelativeRotation(CurrentRotation);
 }
 
+/**
+ * @details
+ * 値は Spawn 時に1度だけ設定し、以降はシステムが Age から角度を計算する (OrbitStartAngle + OrbitSpeed * Age)。
+ * 中心・軸はワールド空間で渡すので、システムの LocalSpace の設定に依存しない。(中心は Position、軸は Vector)
+ */
+void AEffectDisplayActor::SetOrbitParameters(UNiagaraComponent* NiagaraComponent)
+{
+	if (OrbitMode != EEffectDisplayOrbitMode::UserParameter)
+	{
+		return;
+	}
+	static const FName OrbitCenterName(TEXT("OrbitCenter"));
+	static const FName OrbitAxisName(TEXT("OrbitAxis"));
+	static const FName OrbitSpeedName(TEXT("OrbitSpeed"));
+	static const FName OrbitStartAngleName(TEXT("OrbitStartAngle"));
+
+	const UNiagaraSystem* NiagaraSystem = NiagaraComponent->GetAsset();
+	if (NiagaraSystem && !OrbitWarnedSystems.Contains(NiagaraSystem->GetFName()))
+	{
+		const FNiagaraVariable OrbitSpeedVariable(FNiagaraTypeDefinition::GetFloatDef(), TEXT("User.OrbitSpeed"));
+		if (NiagaraSystem->GetExposedParameters().IndexOf(OrbitSpeedVariable) == INDEX_NONE)
+		{
+			OrbitWarnedSystems.Add(NiagaraSystem->GetFName());
+			UE_LOG(LogTemp, Warning, TEXT("[AEffectDisplayActor] %s does not expose User.OrbitSpeed. It will not orbit."), *NiagaraSystem->GetName());
+		}
+	}
+	//note: ワールド座標は LWC のタイルオフセットが適用されるよう Position 型で渡す
+	NiagaraComponent->SetVariablePosition(OrbitCenterName, RotationRoot->GetComponentLocation());
+	NiagaraComponent->SetVariableVec3(OrbitAxisName, RotationRoot->GetUpVector());
+	NiagaraComponent->SetVariableFloat(OrbitSpeedName, RotateSpeed);
+	NiagaraComponent->SetVariableFloat(OrbitStartAngleName, OrbitAngle);
+}
+
 #endif // UE_BUILD_DEVELOPMENT
+
@@ -0,0 +1,182 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EffectDisplayCapture.h"
+
+#if EFFECT_DISPLAY_ENABLED
+
+#include "NiagaraComponent.h"
+#include "NiagaraSystem.h"
+#include "NiagaraEmitter.h"
+#include "NiagaraSystemInstance.h"
+#include "NiagaraSystemInstanceController.h"
+#include "NiagaraEmitterInstance.h"
+#include "RenderCore.h"
+#include "RHI.h"
+#include "HAL/PlatformMemory.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+void FEffectDisplayCapture::FFrameTotals::Add(double InGameThreadMs, double InRenderThreadMs, double InGPUMs)
+{
+	++NumFrames;
+	GameThreadMs += InGameThreadMs;
+	RenderThreadMs += InRenderThreadMs;
+	GPUMs += InGPUMs;
+	MaxGameThreadMs = FMath::Max(MaxGameThreadMs, InGameThreadMs);
+}
+
+void FEffectDisplayCapture::SampleFrameTimes(FFrameTotals& Totals)
+{
+	//note: 前フレームの値 (stat unit と同じ)
+	Totals.Add(
+		FPlatformTime::ToMilliseconds(GGameThreadTime),
+		FPlatformTime::ToMilliseconds(GRenderThreadTime),
+		FPlatformTime::ToMilliseconds(RHIGetGPUFrameCycles()));
+}
+
+void FEffectDisplayCapture::SampleBaseline()
+{
+	SampleFrameTimes(Baseline);
+}
+
+void FEffectDisplayCapture::BeginEntry(const UNiagaraSystem* NiagaraSystem, int64 FootprintBytes, int32 NumInstances)
+{
+	CapturingEntryIndex = Entries.AddDefaulted();
+	FEntry& Entry = Entries[CapturingEntryIndex];
+	Entry.SystemName = GetNameSafe(NiagaraSystem);
+	Entry.NumInstances = NumInstances;
+	Entry.FootprintBytes = FootprintBytes;
+	Entry.MemoryAtSpawn = FPlatformMemory::GetStats().UsedPhysical;
+	Entry.PeakMemory = Entry.MemoryAtSpawn;
+	if (NiagaraSystem)
+	{
+		for (const FNiagaraEmitterHandle& EmitterHandle : NiagaraSystem->GetEmitterHandles())
+		{
+			const FVersionedNiagaraEmitterData* EmitterData = EmitterHandle.GetEmitterData();
+			if (!EmitterHandle.GetIsEnabled() || EmitterData == nullptr)
+			{
+				continue;
+			}
+			++Entry.NumEmitters;
+			Entry.NumGPUEmitters += EmitterData->SimTarget == ENiagaraSimTarget::GPUComputeSim ? 1 : 0;
+		}
+	}
+}
+
+void FEffectDisplayCapture::SampleEntry(const TArray<TObjectPtr<UNiagaraComponent>>& NiagaraComponents)
+{
+	if (!IsCapturingEntry() || NiagaraComponents.IsEmpty())
+	{
+		return;
+	}
+	FEntry& Entry = Entries[CapturingEntryIndex];
+	SampleFrameTimes(Entry.Frames);
+	Entry.PeakMemory = FMath::Max<uint64>(Entry.PeakMemory, FPlatformMemory::GetStats().UsedPhysical);
+
+	//note: GPU エミッタのパーティクル数はリードバック済みの値 (数フレーム遅れる)
+	int32 NumParticles = 0;
+	for (const UNiagaraComponent* NiagaraComponent : NiagaraComponents)
+	{
+		if (!NiagaraComponent)
+		{
+			continue;
+		}
+		const auto Controller = NiagaraComponent->GetSystemInstanceController();
+		if (const FNiagaraSystemInstance* SystemInstance = Controller.IsValid() ? Controller->GetSystemInstance_Unsafe() : nullptr)
+		{
+			for (const FNiagaraEmitterInstanceRef& EmitterInstance : SystemInstance->GetEmitters())
+			{
+				NumParticles += EmitterInstance->GetNumParticles();
+			}
+		}
+	}
+	Entry.TotalParticles += NumParticles;
+	Entry.MaxParticles = FMath::Max(Entry.MaxParticles, NumParticles);
+}
+
+void FEffectDisplayCapture::EndEntry(double SpawnMs, double FirstFrameMs)
+{
+	if (!IsCapturingEntry())
+	{
+		return;
+	}
+	FEntry& Entry = Entries[CapturingEntryIndex];
+	CapturingEntryIndex = INDEX_NONE;
+	Entry.SpawnMs = SpawnMs;
+	Entry.FirstFrameMs = FirstFrameMs;
+}
+
+void FEffectDisplayCapture::AddFailedEntry(const FString& SystemPath)
+{
+	FEntry& Entry = Entries.AddDefaulted_GetRef();
+	Entry.SystemName = SystemPath;
+	Entry.bFailed = true;
+}
+
+double FEffectDisplayCapture::GetCost(const FEntry& Entry) const
+{
+	const double GameThreadDelta = Entry.Frames.AverageGameThreadMs() - Baseline.AverageGameThreadMs();
+	const double RenderThreadDelta = Entry.Frames.AverageRenderThreadMs() - Baseline.AverageRenderThreadMs();
+	const double GPUDelta = Entry.Frames.AverageGPUMs() - Baseline.AverageGPUMs();
+	return FMath::Max3(GameThreadDelta, RenderThreadDelta, GPUDelta);
+}
+
+FString FEffectDisplayCapture::WriteReport(const FString& ReportName) const
+{
+	TArray<const FEntry*> Sorted;
+	Sorted.Reserve(Entries.Num());
+	for (const FEntry& Entry : Entries)
+	{
+		Sorted.Add(&Entry);
+	}
+	//ロードに失敗したエントリは末尾
+	Sorted.StableSort([this](const FEntry& A, const FEntry& B)
+	{
+		if (A.bFailed != B.bFailed)
+		{
+			return B.bFailed;
+		}
+		return GetCost(A) > GetCost(B);
+	});
+
+	auto ToKB = [](double Bytes) { return Bytes / 1024.0; };
+	TArray<FString> Lines;
+	Lines.Reserve(Sorted.Num() + 2);
+	Lines.Add(TEXT("Rank,System,Instances,CostMs,Frames,GameThreadMs,GameThreadMaxMs,RenderThreadMs,GPUMs,GameThreadDeltaMs,RenderThreadDeltaMs,GPUDeltaMs,")
+			  TEXT("AvgParticles,MaxParticles,Emitters,GPUEmitters,MemoryDeltaKB,FootprintKB,SpawnMs,FirstFrameMs,Status"));
+	Lines.Add(FString::Printf(TEXT("0,Baseline,0,0,%d,%.3f,%.3f,%.3f,%.3f,0,0,0,0,0,0,0,0,0,0,0,Baseline"),
+		Baseline.NumFrames, Baseline.AverageGameThreadMs(), Baseline.MaxGameThreadMs,
+		Baseline.AverageRenderThreadMs(), Baseline.AverageGPUMs()));
+	for (int32 Rank = 0; Rank < Sorted.Num(); ++Rank)
+	{
+		const FEntry& Entry = *Sorted[Rank];
+		if (Entry.bFailed)
+		{
+			Lines.Add(FString::Printf(TEXT("%d,%s,,,,,,,,,,,,,,,,,,,LoadFailed"), Rank + 1, *Entry.SystemName));
+			continue;
+		}
+		const FFrameTotals& Frames = Entry.Frames;
+		Lines.Add(FString::Printf(TEXT("%d,%s,%d,%.3f,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%d,%d,%d,%.1f,%.1f,%.3f,%.3f,%s"),
+			Rank + 1, *Entry.SystemName, Entry.NumInstances, GetCost(Entry), Frames.NumFrames,
+			Frames.AverageGameThreadMs(), Frames.MaxGameThreadMs, Frames.AverageRenderThreadMs(), Frames.AverageGPUMs(),
+			Frames.AverageGameThreadMs() - Baseline.AverageGameThreadMs(),
+			Frames.AverageRenderThreadMs() - Baseline.AverageRenderThreadMs(),
+			Frames.AverageGPUMs() - Baseline.AverageGPUMs(),
+			Frames.NumFrames > 0 ? static_cast<double>(Entry.TotalParticles) / Frames.NumFrames : .0, Entry.MaxParticles,
+			Entry.NumEmitters, Entry.NumGPUEmitters,
+			ToKB(static_cast<double>(Entry.PeakMemory - Entry.MemoryAtSpawn)), ToKB(static_cast<double>(Entry.FootprintBytes)),
+			Entry.SpawnMs, Entry.FirstFrameMs,
+			Entry.FirstFrameMs < .0 ? TEXT("NoFirstFrame") : TEXT("OK")));
+	}
+
+	const FString Path = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Profiling"), TEXT("LiquidEffectCapture"),
+		FString::Printf(TEXT("%s_%s.csv"), *ReportName, *FDateTime::Now().ToString()));
+	if (!FFileHelper::SaveStringArrayToFile(Lines, *Path))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[FEffectDisplayCapture] Failed to write %s"), *Path);
+		return FString();
+	}
+	return Path;
+}
+
+#endif
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "EffectDisplayActor.h"
+
+#if EFFECT_DISPLAY_ENABLED
+
+class UNiagaraComponent;
+class UNiagaraSystem;
+
+/**
+ * FEffectDisplayCapture
+ *
+ *  - AEffectDisplayActor のキャプチャモード用に、プレイリストのエントリ毎の負荷を計測して CSV に出力する
+ *  - 再生前にエフェクト無しのベースラインを計測し、エントリ毎の値はベースラインとの差分でも出力する
+ *  - スレッド時間はフレーム全体の値(GGameThreadTime / GRenderThreadTime / GPU フレーム時間)の平均
+ *  - 出力は Cost (ゲームスレッド・描画スレッド・GPU のうち、ベースラインからの増加が最大のもの) の降順
+ *  ※GPU 時間は -nullrhi では 0 になる。ヘッドレスで GPU 時間も計測する場合は -RenderOffscreen を使用する
+ */
+class FEffectDisplayCapture
+{
+public:
+	/** @brief ベースラインのフレームを1つ記録する */
+	void SampleBaseline();
+	int32 GetNumBaselineFrames() const {return Baseline.NumFrames;}
+
+	/**
+	 * @brief エントリの計測を開始する。
+	 * @param NumInstances 同時に再生するインスタンスの数
+	 */
+	void BeginEntry(const UNiagaraSystem* NiagaraSystem, int64 FootprintBytes, int32 NumInstances);
+	/** @brief 再生中のフレームを1つ記録する (パーティクル数は全インスタンスの合計) */
+	void SampleEntry(const TArray<TObjectPtr<UNiagaraComponent>>& NiagaraComponents);
+	/**
+	 * @brief エントリの計測を終了する。
+	 * @param SpawnMs Spawn 呼び出しの時間[ms]
+	 * @param FirstFrameMs Spawn 開始から初回フレームまでの時間[ms] (未到達の場合は負値)
+	 */
+	void EndEntry(double SpawnMs, double FirstFrameMs);
+	/** @brief ロードに失敗したエントリを記録する */
+	void AddFailedEntry(const FString& SystemPath);
+	bool IsCapturingEntry() const {return CapturingEntryIndex != INDEX_NONE;}
+
+	/**
+	 * @brief 計測結果を Cost の降順に CSV で出力する。
+	 * @return 出力したファイルのパス (失敗した場合は空)
+	 */
+	FString WriteReport(const FString& ReportName) const;
+
+private:
+	struct FFrameTotals
+	{
+		int32 NumFrames = 0;
+		double GameThreadMs = .0;
+		double RenderThreadMs = .0;
+		double GPUMs = .0;
+		double MaxGameThreadMs = .0;
+
+		void Add(double InGameThreadMs, double InRenderThreadMs, double InGPUMs);
+		double AverageGameThreadMs() const {return NumFrames > 0 ? GameThreadMs / NumFrames : .0;}
+		double AverageRenderThreadMs() const {return NumFrames > 0 ? RenderThreadMs / NumFrames : .0;}
+		double AverageGPUMs() const {return NumFrames > 0 ? GPUMs / NumFrames : .0;}
+	};
+
+	struct FEntry
+	{
+		FString SystemName;
+		FFrameTotals Frames;
+		int64 TotalParticles = 0;
+		int32 MaxParticles = 0;
+		int32 NumEmitters = 0;
+		int32 NumGPUEmitters = 0;
+		int32 NumInstances = 1;
+		uint64 MemoryAtSpawn = 0;
+		uint64 PeakMemory = 0;
+		int64 FootprintBytes = 0;
+		double SpawnMs = .0;
+		double FirstFrameMs = -1.0;
+		bool bFailed = false;
+	};
+
+	/** @return ベースラインからの増加が最大のスレッドの時間[ms] */
+	double GetCost(const FEntry& Entry) const;
+	static void SampleFrameTimes(FFrameTotals& Totals);
+
+	FFrameTotals Baseline{};
+	TArray<FEntry> Entries{};
+	//note: 計測中にロード失敗のエントリが追加されても計測先がずれないよう、Entries.Last() ではなくインデックスで保持する
+	int32 CapturingEntryIndex = INDEX_NONE;
+};
+
+#endif
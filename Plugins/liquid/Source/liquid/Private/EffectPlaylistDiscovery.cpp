@@ -0,0 +1,257 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "EffectPlaylistDiscovery.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Async/Async.h"
+#include "NiagaraSystem.h"
+
+namespace
+{
+	bool IsNiagaraSystemAsset(const FAssetData& AssetData)
+	{
+		return AssetData.AssetClassPath == UNiagaraSystem::StaticClass()->GetClassPathName();
+	}
+
+	/** @return PackagePath が FolderPath またはそのサブフォルダであれば true */
+	bool IsInFolder(const FString& PackagePath, const FString& FolderPath)
+	{
+		return PackagePath.StartsWith(FolderPath)
+			&& (PackagePath.Len() == FolderPath.Len() || PackagePath[FolderPath.Len()] == TEXT('/'));
+	}
+}
+
+FEffectPlaylistDiscovery& FEffectPlaylistDiscovery::Get()
+{
+	static FEffectPlaylistDiscovery Instance;
+	return Instance;
+}
+
+uint64 FEffectPlaylistDiscovery::DiscoverAsync(const FString& FolderPath, FOnDiscovered Callback)
+{
+	check(IsInGameThread());
+	FEntry& Entry = Entries.FindOrAdd(FolderPath);
+	if (Entry.bValid)
+	{
+		if (Callback)
+		{
+			Callback(Entry.Assets);
+		}
+		return 0;
+	}
+
+	uint64 CallbackID = 0;
+	if (Callback)
+	{
+		CallbackID = NextCallbackID++;
+		Entry.Callbacks.Emplace(CallbackID, MoveTemp(Callback));
+	}
+	//検索中の要求はまとめる
+	if (Entry.bQuerying)
+	{
+		return CallbackID;
+	}
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	//note: スキャン中に検索するとフォルダの一部しか返らないため、スキャンの完了を待つ
+	if (AssetRegistry.IsLoadingAssets())
+	{
+		if (!FilesLoadedHandle.IsValid())
+		{
+			UE_LOG(LogTemp, Log, TEXT("[FEffectPlaylistDiscovery] Waiting for the asset registry scan: %s"), *FolderPath);
+			FilesLoadedHandle = AssetRegistry.OnFilesLoaded().AddRaw(this, &FEffectPlaylistDiscovery::OnFilesLoaded);
+		}
+		return CallbackID;
+	}
+	BindAssetEvents();
+	StartQuery(FolderPath);
+	return CallbackID;
+}
+
+void FEffectPlaylistDiscovery::CancelCallback(const FString& FolderPath, uint64 CallbackID)
+{
+	if (CallbackID == 0)
+	{
+		return;
+	}
+	if (FEntry* Entry = Entries.Find(FolderPath))
+	{
+		Entry->Callbacks.RemoveAll([CallbackID](const TPair<uint64, FOnDiscovered>& Callback)
+		{
+			return Callback.Key == CallbackID;
+		});
+	}
+}
+
+const TArray<FEffectPlaylistAsset>* FEffectPlaylistDiscovery::FindCached(const FString& FolderPath) const
+{
+	const FEntry* Entry = Entries.Find(FolderPath);
+	return Entry && Entry->bValid ? &Entry->Assets : nullptr;
+}
+
+void FEffectPlaylistDiscovery::Invalidate()
+{
+	for (TPair<FString, FEntry>& Pair : Entries)
+	{
+		Pair.Value.Assets.Reset();
+		Pair.Value.bValid = false;
+		++Pair.Value.Generation;
+	}
+}
+
+void FEffectPlaylistDiscovery::Shutdown()
+{
+	if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+	{
+		AssetRegistry->OnFilesLoaded().Remove(FilesLoadedHandle);
+		AssetRegistry->OnAssetAdded().Remove(AssetAddedHandle);
+		AssetRegistry->OnAssetRemoved().Remove(AssetRemovedHandle);
+		AssetRegistry->OnAssetRenamed().Remove(AssetRenamedHandle);
+	}
+	FilesLoadedHandle.Reset();
+	AssetAddedHandle.Reset();
+	AssetRemovedHandle.Reset();
+	AssetRenamedHandle.Reset();
+	//note: 検索中のタスクの結果は OnQueryCompleted でエントリが見つからないので破棄される
+	Entries.Reset();
+}
+
+/**
+ * @details
+ * AssetRegistry の検索はスレッドセーフなので、検索とパッケージサイズの取得をワーカースレッドで行い、結果をゲームスレッドへ返す。
+ */
+void FEffectPlaylistDiscovery::StartQuery(const FString& FolderPath)
+{
+	FEntry& Entry = Entries.FindChecked(FolderPath);
+	Entry.bQuerying = true;
+	Entry.QueryStartTime = FPlatformTime::Seconds();
+
+	FARFilter Filter;
+	Filter.PackagePaths.Add(*FolderPath);
+	Filter.bRecursivePaths = true;
+	Filter.bIncludeOnlyOnDiskAssets = true;
+	Filter.ClassPaths.Add(UNiagaraSystem::StaticClass()->GetClassPathName());
+
+	const uint32 Generation = Entry.Generation;
+	Async(EAsyncExecution::ThreadPool, [FolderPath, Generation, Filter = MoveTemp(Filter)]()
+	{
+		const IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+		TArray<FAssetData> AssetDataArray;
+		AssetRegistry.GetAssets(Filter, AssetDataArray);
+
+		TArray<FEffectPlaylistAsset> Assets;
+		Assets.Reserve(AssetDataArray.Num());
+		for (FAssetData& AssetData : AssetDataArray)
+		{
+			FEffectPlaylistAsset& Asset = Assets.AddDefaulted_GetRef();
+			if (const TOptional<FAssetPackageData> PackageData = AssetRegistry.GetAssetPackageDataCopy(AssetData.PackageName))
+			{
+				Asset.DiskSize = PackageData->DiskSize;
+			}
+			Asset.AssetData = MoveTemp(AssetData);
+		}
+		AsyncTask(ENamedThreads::GameThread, [FolderPath, Generation, Assets = MoveTemp(Assets)]() mutable
+		{
+			Get().OnQueryCompleted(FolderPath, Generation, MoveTemp(Assets));
+		});
+	});
+}
+
+void FEffectPlaylistDiscovery::OnQueryCompleted(const FString& FolderPath, uint32 Generation, TArray<FEffectPlaylistAsset>&& Assets)
+{
+	FEntry* Entry = Entries.Find(FolderPath);
+	if (Entry == nullptr || !Entry->bQuerying)
+	{
+		return;
+	}
+	//検索中にフォルダのアセットが変わった場合は検索し直す
+	if (Entry->Generation != Generation)
+	{
+		StartQuery(FolderPath);
+		return;
+	}
+	Entry->bQuerying = false;
+	Entry->bValid = true;
+	Entry->Assets = MoveTemp(Assets);
+	UE_LOG(LogTemp, Log, TEXT("[FEffectPlaylistDiscovery] Found %d Niagara systems in %s (%.3f sec)"),
+		Entry->Assets.Num(), *FolderPath, FPlatformTime::Seconds() - Entry->QueryStartTime);
+
+	//コールバック内で DiscoverAsync されても良いように取り出してから呼ぶ
+	const TArray<FEffectPlaylistAsset> Result = Entry->Assets;
+	TArray<TPair<uint64, FOnDiscovered>> Callbacks = MoveTemp(Entry->Callbacks);
+	for (TPair<uint64, FOnDiscovered>& Callback : Callbacks)
+	{
+		Callback.Value(Result);
+	}
+}
+
+void FEffectPlaylistDiscovery::OnFilesLoaded()
+{
+	if (IAssetRegistry* AssetRegistry = IAssetRegistry::Get())
+	{
+		AssetRegistry->OnFilesLoaded().Remove(FilesLoadedHandle);
+	}
+	FilesLoadedHandle.Reset();
+	BindAssetEvents();
+
+	TArray<FString> PendingFolders;
+	for (const TPair<FString, FEntry>& Pair : Entries)
+	{
+		if (!Pair.Value.bValid && !Pair.Value.bQuerying)
+		{
+			PendingFolders.Add(Pair.Key);
+		}
+	}
+	for (const FString& FolderPath : PendingFolders)
+	{
+		StartQuery(FolderPath);
+	}
+}
+
+/**
+ * @details
+ * スキャン中は OnAssetAdded が全てのアセットに対して呼ばれるため、スキャン完了後に登録する。
+ */
+void FEffectPlaylistDiscovery::BindAssetEvents()
+{
+	if (AssetAddedHandle.IsValid())
+	{
+		return;
+	}
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	AssetAddedHandle = AssetRegistry.OnAssetAdded().AddRaw(this, &FEffectPlaylistDiscovery::OnAssetChanged);
+	AssetRemovedHandle = AssetRegistry.OnAssetRemoved().AddRaw(this, &FEffectPlaylistDiscovery::OnAssetChanged);
+	AssetRenamedHandle = AssetRegistry.OnAssetRenamed().AddRaw(this, &FEffectPlaylistDiscovery::OnAssetRenamed);
+}
+
+void FEffectPlaylistDiscovery::OnAssetChanged(const FAssetData& AssetData)
+{
+	if (IsNiagaraSystemAsset(AssetData))
+	{
+		InvalidatePackagePath(AssetData.PackagePath.ToString());
+	}
+}
+
+void FEffectPlaylistDiscovery::OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath)
+{
+	if (IsNiagaraSystemAsset(AssetData))
+	{
+		InvalidatePackagePath(AssetData.PackagePath.ToString());
+		InvalidatePackagePath(FPackageName::GetLongPackagePath(OldObjectPath));
+	}
+}
+
+void FEffectPlaylistDiscovery::InvalidatePackagePath(const FString& PackagePath)
+{
+	for (TPair<FString, FEntry>& Pair : Entries)
+	{
+		if (!IsInFolder(PackagePath, Pair.Key))
+		{
+			continue;
+		}
+		UE_LOG(LogTemp, Verbose, TEXT("[FEffectPlaylistDiscovery] Invalidate %s"), *Pair.Key);
+		Pair.Value.Assets.Reset();
+		Pair.Value.bValid = false;
+		++Pair.Value.Generation;
+	}
+}
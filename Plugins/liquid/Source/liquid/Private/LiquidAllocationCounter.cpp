@@ -0,0 +1,143 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidAllocationCounter.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "HAL/MemoryBase.h"
+#include "Misc/CommandLine.h"
+#include "Misc/Parse.h"
+#include <atomic>
+
+namespace
+{
+	/**
+	 * @brief ゲームスレッドのアロケーション回数を数える GMalloc のプロキシ。全ての呼び出しを元のアロケータへ委譲する。
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInner) : Inner(InInner) {}
+
+		void BeginCount()
+		{
+			check(IsInGameThread());
+			NumAllocations = 0;
+			bCounting.store(true, std::memory_order_relaxed);
+		}
+		uint64 EndCount()
+		{
+			check(IsInGameThread());
+			bCounting.store(false, std::memory_order_relaxed);
+			return NumAllocations;
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Malloc(Count, Alignment);
+		}
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->TryMalloc(Count, Alignment);
+		}
+		virtual void* MallocZeroed(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->MallocZeroed(Count, Alignment);
+		}
+		virtual void* TryMallocZeroed(SIZE_T Count, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->TryMallocZeroed(Count, Alignment);
+		}
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			if (Count > 0)
+			{
+				CountAllocation();
+			}
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+		virtual void Free(void* Original) override {Inner->Free(Original);}
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override {return Inner->QuantizeSize(Count, Alignment);}
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override {return Inner->GetAllocationSize(Original, SizeOut);}
+		virtual void Trim(bool bTrimThreadCaches) override {Inner->Trim(bTrimThreadCaches);}
+		virtual void SetupTLSCachesOnCurrentThread() override {Inner->SetupTLSCachesOnCurrentThread();}
+		virtual void MarkTLSCachesAsUsedOnCurrentThread() override {Inner->MarkTLSCachesAsUsedOnCurrentThread();}
+		virtual void MarkTLSCachesAsUnusedOnCurrentThread() override {Inner->MarkTLSCachesAsUnusedOnCurrentThread();}
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override {Inner->ClearAndDisableTLSCachesOnCurrentThread();}
+		virtual void InitializeStatsMetadata() override {Inner->InitializeStatsMetadata();}
+		virtual void UpdateStats() override {Inner->UpdateStats();}
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override {Inner->GetAllocatorStats(OutStats);}
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override {Inner->DumpAllocatorStats(Ar);}
+		virtual bool IsInternallyThreadSafe() const override {return Inner->IsInternallyThreadSafe();}
+		virtual bool ValidateHeap() override {return Inner->ValidateHeap();}
+		virtual const TCHAR* GetDescriptiveName() override {return Inner->GetDescriptiveName();}
+		virtual void OnMallocInitialized() override {Inner->OnMallocInitialized();}
+		virtual void OnPreFork() override {Inner->OnPreFork();}
+		virtual void OnPostFork() override {Inner->OnPostFork();}
+		virtual uint64 GetImmediatelyFreeableCachedMemorySize() const override {return Inner->GetImmediatelyFreeableCachedMemorySize();}
+		virtual uint64 GetTotalFreeCachedMemorySize() const override {return Inner->GetTotalFreeCachedMemorySize();}
+		virtual bool Exec(UWorld* InWorld, const TCHAR* Cmd, FOutputDevice& Ar) override {return Inner->Exec(InWorld, Cmd, Ar);}
+
+	private:
+		void CountAllocation()
+		{
+			//note: NumAllocations はゲームスレッドからのみ更新する
+			if (bCounting.load(std::memory_order_relaxed) && IsInGameThread())
+			{
+				++NumAllocations;
+			}
+		}
+
+		FMalloc* const Inner;
+		std::atomic<bool> bCounting{false};
+		uint64 NumAllocations = 0;
+	};
+
+	/** 一度インストールしたプロキシは破棄しない (他スレッドから参照され続けるため) */
+	FCountingMalloc* GCountingMalloc = nullptr;
+}
+
+void FLiquidAllocationCounter::Install()
+{
+	check(IsInGameThread());
+	if (GCountingMalloc || !FParse::Param(FCommandLine::Get(), TEXT("LiquidCountAllocations")))
+	{
+		return;
+	}
+	//note: 以降の GMalloc の読み出しが古いアロケータ・プロキシのどちらを指していても、同じアロケータへ委譲されるので安全
+	GCountingMalloc = new FCountingMalloc(GMalloc);
+	FPlatformAtomics::InterlockedExchangePtr(reinterpret_cast<void**>(&GMalloc), GCountingMalloc);
+	UE_LOG(LogTemp, Display, TEXT("[FLiquidAllocationCounter] Counting game thread allocations (%s)"), GCountingMalloc->GetDescriptiveName());
+}
+
+bool FLiquidAllocationCounter::IsEnabled()
+{
+	return GCountingMalloc != nullptr;
+}
+
+void FLiquidAllocationCounter::BeginCount()
+{
+	if (GCountingMalloc)
+	{
+		GCountingMalloc->BeginCount();
+	}
+}
+
+uint64 FLiquidAllocationCounter::EndCount()
+{
+	return GCountingMalloc ? GCountingMalloc->EndCount() : 0;
+}
+
+#endif
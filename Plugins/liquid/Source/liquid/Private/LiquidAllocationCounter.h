@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * FLiquidAllocationCounter
+ *
+ *  - ベンチマーク用に、ゲームスレッドのアロケーション回数を数える
+ *  - コマンドライン引数 -LiquidCountAllocations を指定した場合のみ、モジュールの起動時に GMalloc をプロキシで包む
+ *    (実行中の差し替え・解除は行わない。プロキシは全ての仮想関数を元のアロケータへ委譲し、アロケーションの挙動を変えない)
+ *  - 指定しない場合は IsEnabled() が false になり、計測できない
+ */
+class FLiquidAllocationCounter
+{
+public:
+	/** @brief -LiquidCountAllocations が指定されていれば GMalloc をプロキシで包む (StartupModule から呼ぶ) */
+	static void Install();
+	/** @return プロキシがインストールされていれば true */
+	static bool IsEnabled();
+
+	/** @brief ゲームスレッドのアロケーション回数の計測を開始する */
+	static void BeginCount();
+	/** @return BeginCount からのゲームスレッドのアロケーション回数 (Malloc / Realloc) */
+	static uint64 EndCount();
+};
+
+#endif
@@ -0,0 +1,653 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PostProcessCallSubsystem.h"
+#include "RuntimeAssetPtr.h"
+#include "RuntimeAssetBatch.h"
+#include "EffectDisplayActor.h"
+#include "LiquidPSOWarmupSubsystem.h"
+#include "EngineUtils.h"
+#include "HAL/IConsoleManager.h"
+#include "LiquidAllocationCounter.h"
+#include "LiquidBenchmark.h"
+#include "Containers/Ticker.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+
+#if !UE_BUILD_SHIPPING
+
+/*
+ * liquid ランタイムモジュールのベンチマーク (コンソールコマンド)
+ *
+ * - liquid.Benchmark.TransientTasks <EffectID> [Frames] : 再生呼び出しのレイテンシ・再生毎のアロケーション数・同時実行数毎の更新コスト
+ *                                                         (アロケーション数は -LiquidCountAllocations を指定して起動した場合のみ)
+ * - liquid.Benchmark.AssetLoad <PackagePath> [MaxAssets] [Shared|Batch] : フォルダ内のアセットを TRuntimeAssetPtr::LoadAsync でまとめてロードする時間
+ * - liquid.Benchmark.EffectDisplay                       : AEffectDisplayActor のプレイリストのロード時間・依存アセットのメモリ使用量・再生コスト
+ * - liquid.Benchmark.EffectBundles                       : ロード済みポストプロセスの依存アセットのメモリ使用量
+ * - liquid.Benchmark.PSOWarmup                           : PSO ウォームアップの完了までの時間・要求したパーミュテーション
+ *                                                         (-nullrhi ではパーミュテーションの記録のみ)
+ * - liquid.Benchmark.AssetPtrStress <PackagePath> [Cycles] [PtrsPerCycle] : TRuntimeAssetPtr の生成・ロード・ムーブ・破棄を繰り返し、
+ *                                                         Reset / 破棄後にコールバックが呼ばれないことを確認する
+ *
+ * 結果は Saved/Benchmarks/Liquid<Suite>.json に出力する。
+ * liquid.Benchmark.Max* の閾値を超えた場合はエラーとし、-unattended 実行時は終了コード 1 で終了する。
+ * ヘッドレス実行例: -nullrhi -unattended -ExecCmds="liquid.Benchmark.TransientTasks <EffectID> 120"
+ * TransientTasks / AssetLoad / AssetPtrStress はオートメーションテスト(Liquid.Benchmark.*)としても実行できる。
+ */
+namespace LiquidBenchmark
+{
+	static TAutoConsoleVariable<float> CVarMaxPlayMicroseconds(
+		TEXT("liquid.Benchmark.MaxPlayMicroseconds"), .0f,
+		TEXT("Fail threshold of play call latency [us/call]. 0 disables."));
+	static TAutoConsoleVariable<float> CVarMaxTickMicrosecondsPerTask(
+		TEXT("liquid.Benchmark.MaxTickMicrosecondsPerTask"), .0f,
+		TEXT("Fail threshold of steady state tick cost [us/task/frame]. 0 disables."));
+	static TAutoConsoleVariable<float> CVarMaxAllocationsPerPlay(
+		TEXT("liquid.Benchmark.MaxAllocationsPerPlay"), .0f,
+		TEXT("Fail threshold of game thread allocations per play call. 0 disables."));
+	static TAutoConsoleVariable<float> CVarMaxAssetLoadSeconds(
+		TEXT("liquid.Benchmark.MaxAssetLoadSeconds"), .0f,
+		TEXT("Fail threshold of TRuntimeAssetPtr batch load time [sec]. 0 disables."));
+	static TAutoConsoleVariable<float> CVarMaxPlaylistLoadSeconds(
+		TEXT("liquid.Benchmark.MaxPlaylistLoadSeconds"), .0f,
+		TEXT("Fail threshold of AEffectDisplayActor playlist load time [sec]. 0 disables."));
+	static TAutoConsoleVariable<float> CVarMaxSpawnMilliseconds(
+		TEXT("liquid.Benchmark.MaxSpawnMilliseconds"), .0f,
+		TEXT("Fail threshold of AEffectDisplayActor average spawn time of a playlist entry [ms]. 0 disables."));
+	static TAutoConsoleVariable<float> CVarMaxEffectBundleKilobytes(
+		TEXT("liquid.Benchmark.MaxEffectBundleKilobytes"), .0f,
+		TEXT("Fail threshold of the dependency footprint of one effect [KB]. 0 disables."));
+	static TAutoConsoleVariable<float> CVarMaxPSOWarmupSeconds(
+		TEXT("liquid.Benchmark.MaxPSOWarmupSeconds"), .0f,
+		TEXT("Fail threshold of ULiquidPSOWarmupSubsystem warmup time [sec]. 0 disables."));
+	static TAutoConsoleVariable<float> CVarTimeoutSeconds(
+		TEXT("liquid.Benchmark.TimeoutSeconds"), 120.0f,
+		TEXT("Timeout of asynchronous benchmarks [sec]."));
+
+	/**
+	 * @brief 結果を書き出し、OnFinished へ渡す。OnFinished を指定した場合は失敗時も終了しない。
+	 */
+	static void FinishReport(FReport& Report, const FOnFinished& OnFinished)
+	{
+		Report.Finish(!OnFinished);
+		if (OnFinished)
+		{
+			OnFinished(Report);
+		}
+	}
+
+	void WaitUntil(TFunction<bool()> IsDone, TFunction<void(bool)> Finish)
+	{
+		const double TimeoutTime = FPlatformTime::Seconds() + CVarTimeoutSeconds.GetValueOnGameThread();
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(
+			[IsDone = MoveTemp(IsDone), Finish = MoveTemp(Finish), TimeoutTime](float)
+			{
+				const bool bTimeout = FPlatformTime::Seconds() >= TimeoutTime;
+				if (!IsDone() && !bTimeout)
+				{
+					return true;
+				}
+				Finish(bTimeout);
+				return false;
+			}));
+	}
+}
+
+/**
+ * @brief UPostProcessCallSubsystem のタスク生成・更新コストを計測するマイクロベンチマーク。
+ */
+struct FPostProcessTaskBenchmark
+{
+	static void Run(UPostProcessCallSubsystem& Subsystem, FName EffectID, int32 NumFrames, const LiquidBenchmark::FOnFinished& OnFinished)
+	{
+		using namespace LiquidBenchmark;
+		FReport Report(TEXT("TransientTasks"));
+		//指定が無い場合はロード済みの最初のエフェクト
+		if (EffectID.IsNone())
+		{
+			for (const TPair<FName, FLiquidEffectBundle>& Pair : Subsystem.GetEffectBundles())
+			{
+				if (Subsystem.GetLoadedMaterial(Pair.Key))
+				{
+					EffectID = Pair.Key;
+					break;
+				}
+			}
+		}
+		const FTransientPostProcessConfig* Config = Subsystem.FindConfig(EffectID);
+		if (!Config || !Subsystem.GetLoadedMaterial(EffectID))
+		{
+			Report.Fail(FString::Printf(TEXT("%s is not found or not loaded yet"), *EffectID.ToString()));
+			FinishReport(Report, OnFinished);
+			return;
+		}
+		NumFrames = FMath::Max(NumFrames, 1);
+		//note: 閾値を判定できない場合は黙って通さずにエラーとする
+		if (!FLiquidAllocationCounter::IsEnabled())
+		{
+			if (CVarMaxAllocationsPerPlay.GetValueOnGameThread() > .0f)
+			{
+				Report.Fail(TEXT("liquid.Benchmark.MaxAllocationsPerPlay requires -LiquidCountAllocations"));
+			}
+			else
+			{
+				UE_LOG(LogTemp, Display, TEXT("[LiquidBenchmark] Allocations are not measured. Start with -LiquidCountAllocations to count them."));
+			}
+		}
+
+		//note: 再生中のタスクは計測結果に影響するため退避しておき、計測後に戻す
+		TArray<FTransientPostProcessTask> SavedTasks = MoveTemp(Subsystem.TransientTasks);
+		Subsystem.TransientTasks.Reset();
+		//note: 計測する同時実行数まで上限を引き上げる (行の MaxConcurrentInstances は適用されたまま)
+		const int32 SavedMaxTransientTasks = Subsystem.MaxTransientTasks;
+		for (const int32 NumTasks : {16, 64, 256})
+		{
+			Subsystem.MaxTransientTasks = NumTasks;
+			Subsystem.TransientTasks.Reserve(NumTasks);
+			//note: 連続呼び出しが RetriggerCooldown で破棄されないよう、クールダウン判定以降(BeginTransientPostProcess)を計測する
+			FLiquidAllocationCounter::BeginCount();
+			const double PlayStartTime = FPlatformTime::Seconds();
+			for (int32 Index = 0; Index < NumTasks; ++Index)
+			{
+				Subsystem.BeginTransientPostProcess(EffectID, Config);
+			}
+			const double PlaySeconds = FPlatformTime::Seconds() - PlayStartTime;
+			const uint64 PlayAllocations = FLiquidAllocationCounter::EndCount();
+			const int32 NumActiveTasks = Subsystem.TransientTasks.Num();
+
+			//note: DeltaTime 0 で更新し、計測中にタスクが終了しないようにする。初回はカメラグループ確保のため計測から除外
+			Subsystem.TickTransientTasks(.0f);
+			FLiquidAllocationCounter::BeginCount();
+			const double TickStartTime = FPlatformTime::Seconds();
+			for (int32 Frame = 0; Frame < NumFrames; ++Frame)
+			{
+				Subsystem.TickTransientTasks(.0f);
+			}
+			const double TickSeconds = FPlatformTime::Seconds() - TickStartTime;
+			const uint64 TickAllocations = FLiquidAllocationCounter::EndCount();
+
+			const FString Prefix = FString::Printf(TEXT("N%d."), NumTasks);
+			Report.Add(Prefix + TEXT("ActiveTasks"), NumActiveTasks, TEXT("tasks"));
+			Report.Add(Prefix + TEXT("PlayLatency"), PlaySeconds * 1.0e6 / NumTasks, TEXT("us/call"),
+				CVarMaxPlayMicroseconds.GetValueOnGameThread());
+			if (FLiquidAllocationCounter::IsEnabled())
+			{
+				Report.Add(Prefix + TEXT("AllocationsPerPlay"), static_cast<double>(PlayAllocations) / NumTasks, TEXT("allocs/call"),
+					CVarMaxAllocationsPerPlay.GetValueOnGameThread());
+			}
+			Report.Add(Prefix + TEXT("TickCost"), TickSeconds * 1.0e6 / NumFrames, TEXT("us/frame"));
+			Report.Add(Prefix + TEXT("TickCostPerTask"), TickSeconds * 1.0e6 / NumFrames / FMath::Max(NumActiveTasks, 1), TEXT("us/task/frame"),
+				CVarMaxTickMicrosecondsPerTask.GetValueOnGameThread());
+			if (FLiquidAllocationCounter::IsEnabled())
+			{
+				Report.Add(Prefix + TEXT("AllocationsPerFrame"), static_cast<double>(TickAllocations) / NumFrames, TEXT("allocs/frame"));
+			}
+			Subsystem.ClearTransientTasks();
+		}
+		Subsystem.MaxTransientTasks = SavedMaxTransientTasks;
+		Subsystem.TransientTasks = MoveTemp(SavedTasks);
+		FinishReport(Report, OnFinished);
+	}
+};
+
+namespace LiquidBenchmark
+{
+	/**
+	 * @brief フォルダ内のアセットを TRuntimeAssetPtr でまとめて非同期ロードし、全て終わるまでの時間を計測する。
+	 * ※ロード済みのアセットは計測対象外 (AlreadyLoaded として報告)
+	 * Shared の場合は FRuntimeAssetCache 経由で、1アセットにつき2つの TRuntimeAssetPtr から同時に要求する。
+	 * Batch の場合は TRuntimeAssetBatch で1つのリクエストにまとめて要求する。
+	 */
+	void RunAssetLoad(const FString& PackagePath, int32 MaxAssets, const FString& Mode, FOnFinished OnFinished)
+	{
+		const bool bShared = Mode == TEXT("Shared");
+		const bool bBatch = Mode == TEXT("Batch");
+		const IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+		FARFilter Filter;
+		Filter.PackagePaths.Add(*PackagePath);
+		Filter.bRecursivePaths = true;
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssets(Filter, Assets);
+		if (MaxAssets > 0 && Assets.Num() > MaxAssets)
+		{
+			Assets.SetNum(MaxAssets);
+		}
+
+		struct FState
+		{
+			TArray<TRuntimeAssetPtr<UObject>> AssetPtrs;
+			TRuntimeAssetBatch<UObject> Batch;
+			int32 NumAlreadyLoaded = 0;
+			double StartTime = .0;
+		};
+		const TSharedRef<FState> State = MakeShared<FState>();
+		State->AssetPtrs.Reserve(Assets.Num());
+		TArray<TSoftObjectPtr<UObject>> BatchSoftPtrs;
+		for (const FAssetData& Asset : Assets)
+		{
+			if (Asset.IsAssetLoaded())
+			{
+				++State->NumAlreadyLoaded;
+				continue;
+			}
+			if (bBatch)
+			{
+				BatchSoftPtrs.Emplace(Asset.GetSoftObjectPath());
+				continue;
+			}
+			State->AssetPtrs.Emplace(TSoftObjectPtr<UObject>(Asset.GetSoftObjectPath()), bShared);
+			if (bShared)
+			{
+				State->AssetPtrs.Emplace(TSoftObjectPtr<UObject>(Asset.GetSoftObjectPath()), true);
+			}
+		}
+		State->Batch.SetSoftPtrs(BatchSoftPtrs);
+		State->StartTime = FPlatformTime::Seconds();
+		State->Batch.LoadAsync();
+		for (TRuntimeAssetPtr<UObject>& AssetPtr : State->AssetPtrs)
+		{
+			AssetPtr.LoadAsync();
+		}
+		WaitUntil(
+			[State]()
+			{
+				return !State->Batch.IsLoading() && !State->AssetPtrs.ContainsByPredicate([](const TRuntimeAssetPtr<UObject>& AssetPtr)
+					{
+						return AssetPtr.IsLoading();
+					});
+			},
+			[State, bShared, Mode, OnFinished = MoveTemp(OnFinished)](bool bTimeout)
+			{
+				const double LoadSeconds = FPlatformTime::Seconds() - State->StartTime;
+				const int32 NumRequested = State->AssetPtrs.Num() + State->Batch.Num();
+				int32 NumLoaded = State->Batch.NumLoaded();
+				for (const TRuntimeAssetPtr<UObject>& AssetPtr : State->AssetPtrs)
+				{
+					NumLoaded += AssetPtr.IsLoaded() ? 1 : 0;
+				}
+				FReport Report(TEXT("AssetLoad") + Mode);
+				if (bTimeout)
+				{
+					Report.Fail(TEXT("Timeout"));
+				}
+				if (NumLoaded < NumRequested)
+				{
+					Report.Fail(FString::Printf(TEXT("%d assets failed to load"), NumRequested - NumLoaded));
+				}
+				Report.Add(TEXT("Requested"), NumRequested, TEXT("assets"));
+				Report.Add(TEXT("AlreadyLoaded"), State->NumAlreadyLoaded, TEXT("assets"));
+				Report.Add(TEXT("Loaded"), NumLoaded, TEXT("assets"));
+				Report.Add(TEXT("BatchLoadTime"), LoadSeconds, TEXT("sec"), CVarMaxAssetLoadSeconds.GetValueOnGameThread());
+				Report.Add(TEXT("LoadTimePerAsset"), LoadSeconds * 1000.0 / FMath::Max(NumRequested, 1), TEXT("ms/asset"));
+				if (bShared)
+				{
+					Report.Add(TEXT("SharedCacheEntries"), FRuntimeAssetCache::Get().Num(), TEXT("entries"));
+				}
+				FinishReport(Report, OnFinished);
+			});
+	}
+
+	/**
+	 * @brief TRuntimeAssetPtr を TArray 上で大量に生成・ロード・ムーブ・Reset・破棄し、
+	 * Reset / 破棄後に遅れて届いたコールバック(LateCallbacks)が 0 であることを確認する。
+	 * 同期・非同期、即時・次Tick、共有キャッシュの有無を混在させ、定期的に GC も要求する。
+	 */
+	void RunAssetPtrStress(const FString& PackagePath, int32 NumCycles, int32 PtrsPerCycle, FOnFinished OnFinished)
+	{
+		const IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+		FARFilter Filter;
+		Filter.PackagePaths.Add(*PackagePath);
+		Filter.bRecursivePaths = true;
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssets(Filter, Assets);
+		if (Assets.IsEmpty())
+		{
+			FReport Report(TEXT("AssetPtrStress"));
+			Report.Fail(FString::Printf(TEXT("No assets in %s"), *PackagePath));
+			FinishReport(Report, OnFinished);
+			return;
+		}
+
+		struct FState
+		{
+			TArray<TSoftObjectPtr<UObject>> SoftPtrs;
+			TArray<TRuntimeAssetPtr<UObject>> AssetPtrs;
+			/** AssetPtrs と同じ並び。Reset / 破棄したら true にし、以降のコールバックは LateCallbacks として数える */
+			TArray<TSharedRef<bool>> Invalidated;
+			int32 Cycle = 0;
+			int32 NumCreated = 0;
+			int32 NumReset = 0;
+			int32 NumDestroyed = 0;
+			int32 NumMoved = 0;
+			int32 NumCallbacks = 0;
+			int32 NumLateCallbacks = 0;
+			int32 DrainFrames = 0;
+
+			void Destroy(int32 Index)
+			{
+				*Invalidated[Index] = true;
+				AssetPtrs.RemoveAtSwap(Index, EAllowShrinking::No);
+				Invalidated.RemoveAtSwap(Index, EAllowShrinking::No);
+				++NumDestroyed;
+			}
+		};
+		const TSharedRef<FState> State = MakeShared<FState>();
+		for (const FAssetData& Asset : Assets)
+		{
+			State->SoftPtrs.Emplace(Asset.GetSoftObjectPath());
+		}
+
+		NumCycles = FMath::Max(NumCycles, 1);
+		PtrsPerCycle = FMath::Max(PtrsPerCycle, 1);
+		WaitUntil(
+			[State, NumCycles, PtrsPerCycle]()
+			{
+				FState& S = *State;
+				if (S.Cycle >= NumCycles)
+				{
+					//全て破棄した後、遅れて届くコールバックを数フレーム待つ
+					while (!S.AssetPtrs.IsEmpty())
+					{
+						S.Destroy(S.AssetPtrs.Num() - 1);
+					}
+					return ++S.DrainFrames > 30;
+				}
+				++S.Cycle;
+
+				//生成してロード (TArray の再確保による再配置も発生させる)
+				for (int32 Count = 0; Count < PtrsPerCycle; ++Count)
+				{
+					const TSoftObjectPtr<UObject>& SoftPtr = S.SoftPtrs[FMath::RandHelper(S.SoftPtrs.Num())];
+					TRuntimeAssetPtr<UObject>& AssetPtr = S.AssetPtrs.Emplace_GetRef(SoftPtr, FMath::RandBool());
+					AssetPtr.SetCallbackTiming(FMath::RandBool() ? ERuntimeAssetCallbackTiming::Immediate : ERuntimeAssetCallbackTiming::NextTick);
+					const TSharedRef<bool>& bInvalidated = S.Invalidated.Add_GetRef(MakeShared<bool>(false));
+					AssetPtr.LoadAsync([WeakState = TWeakPtr<FState>(State), bInvalidated](UObject*)
+					{
+						if (const TSharedPtr<FState> Pinned = WeakState.Pin())
+						{
+							++(*bInvalidated ? Pinned->NumLateCallbacks : Pinned->NumCallbacks);
+						}
+					});
+					++S.NumCreated;
+				}
+				//ムーブ (要素の入れ替え)
+				for (int32 Count = 0; Count < PtrsPerCycle / 4 && S.AssetPtrs.Num() > 1; ++Count)
+				{
+					const int32 A = FMath::RandHelper(S.AssetPtrs.Num());
+					const int32 B = FMath::RandHelper(S.AssetPtrs.Num());
+					TRuntimeAssetPtr<UObject> Temp(MoveTemp(S.AssetPtrs[A]));
+					S.AssetPtrs[A] = MoveTemp(S.AssetPtrs[B]);
+					S.AssetPtrs[B] = MoveTemp(Temp);
+					Swap(S.Invalidated[A], S.Invalidated[B]);
+					++S.NumMoved;
+				}
+				//Reset (再利用するので再度ロードは要求しない)
+				for (int32 Count = 0; Count < PtrsPerCycle / 4 && !S.AssetPtrs.IsEmpty(); ++Count)
+				{
+					const int32 Index = FMath::RandHelper(S.AssetPtrs.Num());
+					S.AssetPtrs[Index].Reset();
+					*S.Invalidated[Index] = true;
+					++S.NumReset;
+				}
+				//破棄 (RemoveAtSwap で末尾の要素が再配置される)
+				for (int32 Count = 0; Count < PtrsPerCycle / 2 && !S.AssetPtrs.IsEmpty(); ++Count)
+				{
+					S.Destroy(FMath::RandHelper(S.AssetPtrs.Num()));
+				}
+				//ロード済みのアセットを解放させ、非同期ロードの経路も通す
+				if (S.Cycle % 60 == 0 && GEngine)
+				{
+					GEngine->ForceGarbageCollection(true);
+				}
+				return false;
+			},
+			[State, OnFinished = MoveTemp(OnFinished)](bool bTimeout)
+			{
+				const FState& S = *State;
+				FReport Report(TEXT("AssetPtrStress"));
+				if (bTimeout)
+				{
+					Report.Fail(TEXT("Timeout"));
+				}
+				if (S.NumLateCallbacks > 0)
+				{
+					Report.Fail(FString::Printf(TEXT("%d callbacks were called after Reset or destruction"), S.NumLateCallbacks));
+				}
+				Report.Add(TEXT("Cycles"), S.Cycle, TEXT("cycles"));
+				Report.Add(TEXT("Created"), S.NumCreated, TEXT("ptrs"));
+				Report.Add(TEXT("Moved"), S.NumMoved, TEXT("swaps"));
+				Report.Add(TEXT("Reset"), S.NumReset, TEXT("ptrs"));
+				Report.Add(TEXT("Destroyed"), S.NumDestroyed, TEXT("ptrs"));
+				Report.Add(TEXT("Callbacks"), S.NumCallbacks, TEXT("calls"));
+				Report.Add(TEXT("LateCallbacks"), S.NumLateCallbacks, TEXT("calls"));
+				FinishReport(Report, OnFinished);
+			});
+	}
+
+	void RunTransientTasks(UWorld* World, const FName& EffectID, int32 NumFrames, FOnFinished OnFinished)
+	{
+		UPostProcessCallSubsystem* Subsystem = World ? World->GetSubsystem<UPostProcessCallSubsystem>() : nullptr;
+		if (!Subsystem)
+		{
+			FReport Report(TEXT("TransientTasks"));
+			Report.Fail(TEXT("UPostProcessCallSubsystem is not found"));
+			FinishReport(Report, OnFinished);
+			return;
+		}
+		//note: -ExecCmds で起動直後に実行された場合に備え、マテリアルのロード完了を待ってから計測する
+		const TWeakObjectPtr<UPostProcessCallSubsystem> WeakSubsystem(Subsystem);
+		WaitUntil(
+			[WeakSubsystem]()
+			{
+				return !WeakSubsystem.IsValid() || WeakSubsystem->IsTransientPostProcessReady();
+			},
+			[WeakSubsystem, EffectID, NumFrames, OnFinished = MoveTemp(OnFinished)](bool bTimeout)
+			{
+				if (!WeakSubsystem.IsValid() || bTimeout)
+				{
+					FReport Report(TEXT("TransientTasks"));
+					Report.Fail(bTimeout ? TEXT("Timeout") : TEXT("UPostProcessCallSubsystem is destroyed"));
+					FinishReport(Report, OnFinished);
+					return;
+				}
+				FPostProcessTaskBenchmark::Run(*WeakSubsystem, EffectID, NumFrames, OnFinished);
+			});
+	}
+
+#if EFFECT_DISPLAY_ENABLED
+	/**
+	 * @brief World 上の全ての AEffectDisplayActor のプレイリストのロード完了を待ち、ロード時間を報告する。
+	 */
+	static void RunEffectDisplay(UWorld* World)
+	{
+		TArray<TWeakObjectPtr<AEffectDisplayActor>> Actors;
+		for (TActorIterator<AEffectDisplayActor> It(World); It; ++It)
+		{
+			Actors.Add(*It);
+		}
+		WaitUntil(
+			[Actors]()
+			{
+				return !Actors.ContainsByPredicate([](const TWeakObjectPtr<AEffectDisplayActor>& Actor)
+					{
+						return Actor.IsValid() && !Actor->IsPlaylistLoaded();
+					});
+			},
+			[Actors](bool bTimeout)
+			{
+				FReport Report(TEXT("EffectDisplay"));
+				if (bTimeout)
+				{
+					Report.Fail(TEXT("Timeout"));
+				}
+				if (Actors.IsEmpty())
+				{
+					Report.Fail(TEXT("AEffectDisplayActor is not found"));
+				}
+				float MaxLoadSeconds = .0f;
+				const float MaxBundleKilobytes = CVarMaxEffectBundleKilobytes.GetValueOnGameThread();
+				for (const TWeakObjectPtr<AEffectDisplayActor>& Actor : Actors)
+				{
+					if (Actor.IsValid() && Actor->IsPlaylistLoaded())
+					{
+						Report.Add(Actor->GetName() + TEXT(".PlaylistDiscoveryTime"), Actor->GetPlaylistDiscoverySeconds(), TEXT("sec"));
+						Report.Add(Actor->GetName() + TEXT(".PlaylistLoadTime"), Actor->GetPlaylistLoadSeconds(), TEXT("sec"));
+						MaxLoadSeconds = FMath::Max(MaxLoadSeconds, Actor->GetPlaylistLoadSeconds());
+						double MaxKilobytes = .0;
+						double TotalKilobytes = .0;
+						for (const TPair<int32, FLiquidEffectBundle>& Pair : Actor->GetLoadedPlaylistBundles())
+						{
+							MaxKilobytes = FMath::Max(MaxKilobytes, Pair.Value.GetTotalBytes() / 1024.0);
+							TotalKilobytes += Pair.Value.GetTotalBytes() / 1024.0;
+						}
+						Report.Add(Actor->GetName() + TEXT(".Slots"), Actor->GetNumSlots(), TEXT("count"));
+						Report.Add(Actor->GetName() + TEXT(".ResidentSystems"), Actor->GetNumResidentSystems(), TEXT("count"));
+						Report.Add(Actor->GetName() + TEXT(".ResidentFootprint"), TotalKilobytes, TEXT("KB"));
+						Report.Add(Actor->GetName() + TEXT(".MaxEffectFootprint"), MaxKilobytes, TEXT("KB"), MaxBundleKilobytes);
+						//note: Spawn / Release は表示台側、FirstFrame はエフェクト側のコストの目安 (再生済みのエフェクトのみ)
+						const FEffectDisplaySpawnStats SpawnStats = Actor->GetTotalSpawnStats();
+						if (SpawnStats.NumSpawns > 0)
+						{
+							Report.Add(Actor->GetName() + TEXT(".Spawns"), SpawnStats.NumSpawns, TEXT("count"));
+							Report.Add(Actor->GetName() + TEXT(".PoolHitRate"), SpawnStats.GetPoolHitRate() * 100.0, TEXT("%"));
+							Report.Add(Actor->GetName() + TEXT(".SpawnTime"), SpawnStats.GetAverageSpawnMs(), TEXT("ms"), CVarMaxSpawnMilliseconds.GetValueOnGameThread());
+							Report.Add(Actor->GetName() + TEXT(".ReleaseTime"), SpawnStats.GetAverageReleaseMs(), TEXT("ms"));
+							Report.Add(Actor->GetName() + TEXT(".FirstFrameTime"), SpawnStats.GetAverageFirstFrameMs(), TEXT("ms"));
+						}
+					}
+				}
+				Report.Add(TEXT("MaxPlaylistLoadTime"), MaxLoadSeconds, TEXT("sec"), CVarMaxPlaylistLoadSeconds.GetValueOnGameThread());
+				Report.Finish();
+			});
+	}
+#endif
+
+	static FAutoConsoleCommandWithWorldAndArgs GTransientTasksCommand(
+		TEXT("liquid.Benchmark.TransientTasks"),
+		TEXT("Measure play latency, allocations per play and tick cost of transient post-process tasks at 16/64/256 concurrent tasks. Usage: liquid.Benchmark.TransientTasks <EffectID> [Frames]"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic([](const TArray<FString>& Args, UWorld* World)
+		{
+			if (!World || Args.IsEmpty())
+			{
+				UE_LOG(LogTemp, Error, TEXT("[LiquidBenchmark] Usage: liquid.Benchmark.TransientTasks <EffectID> [Frames]"));
+				return;
+			}
+			RunTransientTasks(World, FName(*Args[0]), Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 120);
+		}));
+
+	static FAutoConsoleCommandWithArgs GAssetLoadCommand(
+		TEXT("liquid.Benchmark.AssetLoad"),
+		TEXT("Measure TRuntimeAssetPtr::LoadAsync batch load time of the assets in a folder. Usage: liquid.Benchmark.AssetLoad <PackagePath> [MaxAssets] [Shared|Batch]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+		{
+			if (Args.IsEmpty())
+			{
+				UE_LOG(LogTemp, Error, TEXT("[LiquidBenchmark] Usage: liquid.Benchmark.AssetLoad <PackagePath> [MaxAssets] [Shared|Batch]"));
+				return;
+			}
+			RunAssetLoad(Args[0], Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 0, Args.IsValidIndex(2) ? Args[2] : FString());
+		}));
+
+	static FAutoConsoleCommandWithArgs GAssetPtrStressCommand(
+		TEXT("liquid.Benchmark.AssetPtrStress"),
+		TEXT("Stress TRuntimeAssetPtr with rapid create/load/move/reset/destroy cycles. Usage: liquid.Benchmark.AssetPtrStress <PackagePath> [Cycles] [PtrsPerCycle]"),
+		FConsoleCommandWithArgsDelegate::CreateStatic([](const TArray<FString>& Args)
+		{
+			if (Args.IsEmpty())
+			{
+				UE_LOG(LogTemp, Error, TEXT("[LiquidBenchmark] Usage: liquid.Benchmark.AssetPtrStress <PackagePath> [Cycles] [PtrsPerCycle]"));
+				return;
+			}
+			RunAssetPtrStress(
+				Args[0],
+				Args.IsValidIndex(1) ? FCString::Atoi(*Args[1]) : 300,
+				Args.IsValidIndex(2) ? FCString::Atoi(*Args[2]) : 32);
+		}));
+
+	static FAutoConsoleCommandWithWorld GEffectBundlesCommand(
+		TEXT("liquid.Benchmark.EffectBundles"),
+		TEXT("Report the dependency footprint (material, textures, curves) of every loaded transient post-process."),
+		FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+		{
+			const UPostProcessCallSubsystem* Subsystem = World ? World->GetSubsystem<UPostProcessCallSubsystem>() : nullptr;
+			if (!Subsystem)
+			{
+				return;
+			}
+			FReport Report(TEXT("EffectBundles"));
+			const float MaxBundleKilobytes = CVarMaxEffectBundleKilobytes.GetValueOnGameThread();
+			double TotalKilobytes = .0;
+			for (const TPair<FName, FLiquidEffectBundle>& Pair : Subsystem->GetEffectBundles())
+			{
+				UE_LOG(LogTemp, Display, TEXT("[LiquidBenchmark] %s: %s"), *Pair.Key.ToString(), *Pair.Value.ToString());
+				Report.Add(Pair.Key.ToString(), Pair.Value.GetTotalBytes() / 1024.0, TEXT("KB"), MaxBundleKilobytes);
+				TotalKilobytes += Pair.Value.GetTotalBytes() / 1024.0;
+			}
+			Report.Add(TEXT("Total"), TotalKilobytes, TEXT("KB"));
+			Report.Finish();
+		}));
+
+	static FAutoConsoleCommandWithWorld GPSOWarmupCommand(
+		TEXT("liquid.Benchmark.PSOWarmup"),
+		TEXT("Wait for ULiquidPSOWarmupSubsystem and report the warmup time and the requested permutations."),
+		FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+		{
+			const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+			ULiquidPSOWarmupSubsystem* Subsystem = GameInstance ? GameInstance->GetSubsystem<ULiquidPSOWarmupSubsystem>() : nullptr;
+			if (!Subsystem)
+			{
+				FReport Report(TEXT("PSOWarmup"));
+				Report.Fail(TEXT("ULiquidPSOWarmupSubsystem is not found"));
+				Report.Finish();
+				return;
+			}
+			Subsystem->StartPSOWarmup();
+			const TWeakObjectPtr<ULiquidPSOWarmupSubsystem> WeakSubsystem(Subsystem);
+			WaitUntil(
+				[WeakSubsystem]() { return !WeakSubsystem.IsValid() || WeakSubsystem->IsWarmupComplete(); },
+				[WeakSubsystem](bool bTimeout)
+				{
+					FReport Report(TEXT("PSOWarmup"));
+					if (!WeakSubsystem.IsValid() || bTimeout)
+					{
+						Report.Fail(bTimeout ? TEXT("Timeout") : TEXT("Subsystem was destroyed"));
+						Report.Finish();
+						return;
+					}
+					TMap<FString, int32> NumRequestsByPermutation;
+					int32 NumPSOTasks = 0;
+					for (const FLiquidPSOWarmupRequest& Request : WeakSubsystem->GetRequests())
+					{
+						UE_LOG(LogTemp, Display, TEXT("[LiquidBenchmark] %s [%s] %s Tasks: %d%s"),
+							*Request.Material.GetAssetName(), *Request.Permutation, *Request.VertexFactory.ToString(),
+							Request.NumPSOTasks, Request.bPrecached ? TEXT("") : TEXT(" (recorded only)"));
+						++NumRequestsByPermutation.FindOrAdd(Request.Permutation);
+						NumPSOTasks += Request.NumPSOTasks;
+					}
+					Report.Add(TEXT("WarmupTime"), WeakSubsystem->GetWarmupSeconds(), TEXT("sec"), CVarMaxPSOWarmupSeconds.GetValueOnGameThread());
+					Report.Add(TEXT("Requests"), WeakSubsystem->GetRequests().Num(), TEXT("count"));
+					Report.Add(TEXT("PSOTasks"), NumPSOTasks, TEXT("count"));
+					for (const TPair<FString, int32>& Pair : NumRequestsByPermutation)
+					{
+						Report.Add(TEXT("Permutation.") + Pair.Key, Pair.Value, TEXT("count"));
+					}
+					Report.Finish();
+				});
+		}));
+
+#if EFFECT_DISPLAY_ENABLED
+	static FAutoConsoleCommandWithWorld GEffectDisplayCommand(
+		TEXT("liquid.Benchmark.EffectDisplay"),
+		TEXT("Measure playlist load time of every AEffectDisplayActor in the world."),
+		FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+		{
+			if (World)
+			{
+				RunEffectDisplay(World);
+			}
+		}));
+#endif
+}
+
+#endif
@@ -0,0 +1,134 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/App.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+class UWorld;
+
+/*
+ * liquid ランタイムモジュールのベンチマークの共通処理
+ * コンソールコマンド(LiquidBenchmark.cpp)とオートメーションテスト(Tests/LiquidBenchmarkTest.cpp)から使用する
+ */
+namespace LiquidBenchmark
+{
+	/**
+	 * @brief 計測結果を JSON で出力し、閾値判定を行う。
+	 */
+	class FReport
+	{
+	public:
+		explicit FReport(const FString& InSuiteName) : SuiteName(InSuiteName) {}
+
+		/**
+		 * @param Threshold 値の上限 (0 以下で判定しない)
+		 */
+		void Add(const FString& Name, double Value, const TCHAR* Unit, float Threshold = .0f)
+		{
+			const bool bPassed = Threshold <= .0f || Value <= Threshold;
+			bAllPassed &= bPassed;
+			if (bPassed)
+			{
+				UE_LOG(LogTemp, Display, TEXT("[LiquidBenchmark] %s.%s: %.3f %s"), *SuiteName, *Name, Value, Unit);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("[LiquidBenchmark] %s.%s: %.3f %s exceeded threshold %.3f"), *SuiteName, *Name, Value, Unit, Threshold);
+				Failures.Add(FString::Printf(TEXT("%s: %.3f %s exceeded threshold %.3f"), *Name, Value, Unit, Threshold));
+			}
+
+			const TSharedRef<FJsonObject> Result = MakeShared<FJsonObject>();
+			Result->SetStringField(TEXT("name"), Name);
+			Result->SetNumberField(TEXT("value"), Value);
+			Result->SetStringField(TEXT("unit"), Unit);
+			Result->SetNumberField(TEXT("threshold"), Threshold);
+			Result->SetBoolField(TEXT("passed"), bPassed);
+			Results.Add(MakeShared<FJsonValueObject>(Result));
+		}
+
+		void Fail(const FString& Reason)
+		{
+			UE_LOG(LogTemp, Error, TEXT("[LiquidBenchmark] %s: %s"), *SuiteName, *Reason);
+			Errors.Add(MakeShared<FJsonValueString>(Reason));
+			Failures.Add(Reason);
+			bAllPassed = false;
+		}
+
+		/**
+		 * @brief 結果を書き出す。閾値を超えた結果がある場合、-unattended 実行時は終了コード 1 で終了する。
+		 * @param bExitOnFailure false の場合は終了しない (オートメーションテストから実行する場合)
+		 * @return 全ての結果が閾値以内なら true
+		 */
+		bool Finish(bool bExitOnFailure = true)
+		{
+			const TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+			Root->SetStringField(TEXT("suite"), SuiteName);
+			Root->SetStringField(TEXT("engine"), FEngineVersion::Current().ToString());
+			Root->SetStringField(TEXT("configuration"), LexToString(FApp::GetBuildConfiguration()));
+			Root->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+			Root->SetBoolField(TEXT("passed"), bAllPassed);
+			Root->SetArrayField(TEXT("errors"), Errors);
+			Root->SetArrayField(TEXT("results"), Results);
+
+			FString Json;
+			const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Json);
+			FJsonSerializer::Serialize(Root, Writer);
+			const FString FilePath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Benchmarks"), FString::Printf(TEXT("Liquid%s.json"), *SuiteName));
+			if (FFileHelper::SaveStringToFile(Json, *FilePath))
+			{
+				UE_LOG(LogTemp, Display, TEXT("[LiquidBenchmark] %s result: %s"), *SuiteName, *FilePath);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("[LiquidBenchmark] Failed to write %s"), *FilePath);
+			}
+
+			if (!bAllPassed && bExitOnFailure && FApp::IsUnattended())
+			{
+				FPlatformMisc::RequestExitWithStatus(false, 1);
+			}
+			return bAllPassed;
+		}
+
+		bool IsPassed() const {return bAllPassed;}
+		const FString& GetSuiteName() const {return SuiteName;}
+		/** @return 閾値を超えた結果とエラーの内容 */
+		const TArray<FString>& GetFailures() const {return Failures;}
+
+	private:
+		FString SuiteName;
+		TArray<FString> Failures;
+		TArray<TSharedPtr<FJsonValue>> Results;
+		TArray<TSharedPtr<FJsonValue>> Errors;
+		bool bAllPassed = true;
+	};
+
+	/** @brief ベンチマークの終了時に呼ばれる (Finish 済みの結果) */
+	using FOnFinished = TFunction<void(const FReport&)>;
+
+	/**
+	 * @brief 条件を満たすかタイムアウト(liquid.Benchmark.TimeoutSeconds)するまで毎フレーム確認し、終了時に Finish を呼び出す。
+	 * @param IsDone 完了判定
+	 * @param Finish 終了時の処理 (引数はタイムアウトした場合 true)
+	 */
+	void WaitUntil(TFunction<bool()> IsDone, TFunction<void(bool)> Finish);
+
+	/*
+	 * 各ベンチマーク。OnFinished を指定した場合は失敗時も終了せず、結果を OnFinished へ渡す
+	 */
+	/** @param EffectID None の場合は最初にロードされたエフェクト */
+	void RunTransientTasks(UWorld* World, const FName& EffectID, int32 NumFrames, FOnFinished OnFinished = nullptr);
+	void RunAssetLoad(const FString& PackagePath, int32 MaxAssets, const FString& Mode, FOnFinished OnFinished = nullptr);
+	void RunAssetPtrStress(const FString& PackagePath, int32 NumCycles, int32 PtrsPerCycle, FOnFinished OnFinished = nullptr);
+}
+
+#endif
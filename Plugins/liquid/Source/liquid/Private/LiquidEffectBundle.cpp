@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidEffectBundle.h"
+#include "Curves/CurveBase.h"
+#include "Engine/Texture.h"
+#include "Materials/MaterialInterface.h"
+#include "NiagaraSystem.h"
+#include "NiagaraEmitter.h"
+#include "NiagaraRendererProperties.h"
+#include "RHIGlobals.h"
+
+namespace
+{
+	int64 GetEstimatedBytes(UObject* Object)
+	{
+		return Object ? Object->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal) : 0;
+	}
+}
+
+bool FLiquidEffectBundle::MarkVisited(const UObject* Object)
+{
+	if (Object == nullptr)
+	{
+		return false;
+	}
+	bool bAlreadyVisited = false;
+	Visited.Add(Object, &bAlreadyVisited);
+	return !bAlreadyVisited;
+}
+
+void FLiquidEffectBundle::AddMaterial(UMaterialInterface* Material)
+{
+	if (!MarkVisited(Material))
+	{
+		return;
+	}
+	++NumMaterials;
+	MaterialBytes += GetEstimatedBytes(Material);
+
+	//note: 品質レベル・フィーチャーレベルの切り替えで使われるテクスチャも含めて常駐させる
+	TArray<UTexture*> UsedTextures;
+	Material->GetUsedTextures(UsedTextures, EMaterialQualityLevel::Num, true, GMaxRHIFeatureLevel, true);
+	for (UTexture* Texture : UsedTextures)
+	{
+		AddTexture(Texture);
+	}
+}
+
+void FLiquidEffectBundle::AddTexture(UTexture* Texture)
+{
+	if (!MarkVisited(Texture))
+	{
+		return;
+	}
+	Textures.Add(Texture);
+	TextureBytes += GetEstimatedBytes(Texture);
+}
+
+void FLiquidEffectBundle::AddCurve(UCurveBase* Curve)
+{
+	if (!MarkVisited(Curve))
+	{
+		return;
+	}
+	++NumCurves;
+	CurveBytes += GetEstimatedBytes(Curve);
+}
+
+void FLiquidEffectBundle::AddNiagaraSystem(UNiagaraSystem* NiagaraSystem)
+{
+	if (!MarkVisited(NiagaraSystem))
+	{
+		return;
+	}
+	++NumNiagaraSystems;
+	NiagaraBytes += GetEstimatedBytes(NiagaraSystem);
+
+	TArray<UMaterialInterface*> UsedMaterials;
+	for (const FNiagaraEmitterHandle& EmitterHandle : NiagaraSystem->GetEmitterHandles())
+	{
+		const FVersionedNiagaraEmitterData* EmitterData = EmitterHandle.GetEmitterData();
+		if (!EmitterHandle.GetIsEnabled() || EmitterData == nullptr)
+		{
+			continue;
+		}
+		EmitterData->ForEachRenderer([&UsedMaterials](UNiagaraRendererProperties* Renderer)
+		{
+			if (Renderer && Renderer->GetIsEnabled())
+			{
+				Renderer->GetUsedMaterials(nullptr, UsedMaterials);
+			}
+		});
+	}
+	for (UMaterialInterface* Material : UsedMaterials)
+	{
+		AddMaterial(Material);
+	}
+}
+
+void FLiquidEffectBundle::RequestTextureMips(float Seconds) const
+{
+	if (Seconds <= .0f)
+	{
+		return;
+	}
+	for (const TWeakObjectPtr<UTexture>& Texture : Textures)
+	{
+		if (UTexture* Resident = Texture.Get())
+		{
+			Resident->SetForceMipLevelsToBeResident(Seconds);
+		}
+	}
+}
+
+FString FLiquidEffectBundle::ToString() const
+{
+	auto ToKB = [](int64 Bytes) { return static_cast<double>(Bytes) / 1024.0; };
+	return FString::Printf(
+		TEXT("Total: %.1f KB Materials: %d (%.1f KB) Textures: %d (%.1f KB) Curves: %d (%.1f KB) Niagara: %d (%.1f KB)"),
+		ToKB(GetTotalBytes()),
+		NumMaterials, ToKB(MaterialBytes),
+		Textures.Num(), ToKB(TextureBytes),
+		NumCurves, ToKB(CurveBytes),
+		NumNiagaraSystems, ToKB(NiagaraBytes));
+}
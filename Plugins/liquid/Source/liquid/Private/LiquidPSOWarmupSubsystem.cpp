@@ -0,0 +1,289 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidPSOWarmupSubsystem.h"
+#include "LiquidStats.h"
+#include "PostProcessCallSubsystem.h"
+#include "Engine/AssetManager.h"
+#include "Engine/DataTable.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Materials/Material.h"
+#include "Materials/MaterialInterface.h"
+#include "PSOPrecache.h"
+#include "VertexFactory.h"
+#include "Misc/App.h"
+
+bool ULiquidPSOWarmupSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	//note: 描画しないサーバーでは不要
+	return !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+}
+
+void ULiquidPSOWarmupSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	if (bWarmupOnInitialize)
+	{
+		StartPSOWarmup();
+	}
+}
+
+void ULiquidPSOWarmupSubsystem::Deinitialize()
+{
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+	for (TSharedPtr<FStreamableHandle>* Handle : {&TablesHandle, &MaterialsHandle})
+	{
+		if (Handle->IsValid())
+		{
+			(*Handle)->CancelHandle();
+			Handle->Reset();
+		}
+	}
+	PendingPSOTasks.Reset();
+	SET_DWORD_STAT(STAT_LiquidPSOWarmupTasks, 0);
+	bRunning = false;
+	Super::Deinitialize();
+}
+
+/**
+ * @brief ウォームアップ開始。
+ * - PostProcessTables のデータテーブルを非同期ロード (テーブルの行からポストプロセスマテリアルを収集するため)
+ * - テーブルのロード後、RootMaterialPaths 以下のマテリアルと合わせて非同期ロード
+ * - マテリアルのロード後、PSO のプリキャッシュを要求し、全てのコンパイルタスクの完了を待つ
+ */
+void ULiquidPSOWarmupSubsystem::StartPSOWarmup()
+{
+	if (bRunning || bComplete)
+	{
+		return;
+	}
+	bRunning = true;
+	bMaterialsLoaded = false;
+	StartTime = FPlatformTime::Seconds();
+	WarmupSeconds = -1.0f;
+	MaterialPaths.Reset();
+	Requests.Reset();
+	PendingPSOTasks.Reset();
+	NumPSOTasks = 0;
+
+	TArray<FSoftObjectPath> TablePaths;
+	UPostProcessCallSubsystem::GatherConfiguredPostProcessTablePaths(TablePaths);
+	if (TablePaths.IsEmpty())
+	{
+		OnTablesLoaded();
+		return;
+	}
+	TablesHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		MoveTemp(TablePaths),
+		FStreamableDelegate::CreateUObject(this, &ULiquidPSOWarmupSubsystem::OnTablesLoaded));
+}
+
+void ULiquidPSOWarmupSubsystem::OnTablesLoaded()
+{
+	TArray<FSoftObjectPath> TablePaths;
+	UPostProcessCallSubsystem::GatherConfiguredPostProcessTablePaths(TablePaths);
+	for (const FSoftObjectPath& TablePath : TablePaths)
+	{
+		const UDataTable* Table = Cast<UDataTable>(TablePath.ResolveObject());
+		const UScriptStruct* RowStruct = Table ? Table->GetRowStruct() : nullptr;
+		if (!RowStruct || !RowStruct->IsChildOf(FTransientPostProcessConfig::StaticStruct()))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("[ULiquidPSOWarmupSubsystem] Skip invalid post process table: %s"), *TablePath.ToString());
+			continue;
+		}
+		for (const TPair<FName, uint8*>& Row : Table->GetRowMap())
+		{
+			const FTransientPostProcessConfig* Config = reinterpret_cast<const FTransientPostProcessConfig*>(Row.Value);
+			if (!Config->Material.IsNull())
+			{
+				MaterialPaths.AddUnique(Config->Material.ToSoftObjectPath());
+			}
+		}
+	}
+
+	//note: PackagePaths が空のフィルタは全アセットに一致するため、フォルダ未設定の場合は検索しない
+	if (!RootMaterialPaths.IsEmpty())
+	{
+		const IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+		FARFilter Filter;
+		for (const FString& Path : RootMaterialPaths)
+		{
+			Filter.PackagePaths.Add(*Path);
+		}
+		Filter.bRecursivePaths = true;
+		Filter.bRecursiveClasses = true;
+		Filter.ClassPaths.Add(UMaterialInterface::StaticClass()->GetClassPathName());
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssets(Filter, Assets);
+		for (const FAssetData& Asset : Assets)
+		{
+			MaterialPaths.AddUnique(Asset.ToSoftObjectPath());
+		}
+	}
+
+	if (MaterialPaths.IsEmpty())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("[ULiquidPSOWarmupSubsystem] No material found for PSO warmup"));
+		OnMaterialsLoaded();
+		return;
+	}
+	MaterialsHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(
+		MaterialPaths,
+		FStreamableDelegate::CreateUObject(this, &ULiquidPSOWarmupSubsystem::OnMaterialsLoaded));
+}
+
+void ULiquidPSOWarmupSubsystem::OnMaterialsLoaded()
+{
+	if (bMaterialsLoaded)
+	{
+		return;
+	}
+	bMaterialsLoaded = true;
+	//note: NullRHI ではプリキャッシュを要求できないが、要求するパーミュテーションは同じように記録する
+	const bool bCanPrecache = FApp::CanEverRender() && IsComponentPSOPrecachingEnabled();
+	if (!bCanPrecache)
+	{
+		UE_LOG(LogTemp, Log, TEXT("[ULiquidPSOWarmupSubsystem] PSO precaching is not available (NullRHI or r.PSOPrecaching=0). Permutations are recorded only."));
+	}
+	for (const FSoftObjectPath& Path : MaterialPaths)
+	{
+		UMaterialInterface* Material = Cast<UMaterialInterface>(Path.ResolveObject());
+		if (!Material)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("[ULiquidPSOWarmupSubsystem] Material Load Failed: %s"), *Path.ToString());
+			continue;
+		}
+		RequestMaterialPSOs(Material, bCanPrecache);
+	}
+	NumPSOTasks = PendingPSOTasks.Num();
+	SET_DWORD_STAT(STAT_LiquidPSOWarmupTasks, NumPSOTasks);
+	UE_LOG(LogTemp, Log, TEXT("[ULiquidPSOWarmupSubsystem] PSO Requested. Materials: %d Permutations: %d Tasks: %d Load: %.3f sec"),
+		MaterialPaths.Num(), Requests.Num(), NumPSOTasks, FPlatformTime::Seconds() - StartTime);
+
+	//note: コンパイルの完了はワーカースレッドで進むため、ゲームスレッドではポーリングのみ行う
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+		FTickerDelegate::CreateUObject(this, &ULiquidPSOWarmupSubsystem::Tick));
+}
+
+void ULiquidPSOWarmupSubsystem::RequestMaterialPSOs(UMaterialInterface* Material, bool bCanPrecache)
+{
+	const FString Permutation = GetPermutationName(Material);
+	const UMaterial* BaseMaterial = Material->GetMaterial();
+	//ポストプロセス等のメッシュを描画しないドメインは頂点ファクトリを持たず、PSO プリキャッシュの対象外
+	if (!BaseMaterial || BaseMaterial->MaterialDomain != MD_Surface)
+	{
+		FLiquidPSOWarmupRequest& Request = Requests.AddDefaulted_GetRef();
+		Request.Material = FSoftObjectPath(Material);
+		Request.Permutation = Permutation;
+		return;
+	}
+
+	//note: liquid のエフェクトは動的に生成・移動するので Movable として要求する
+	FPSOPrecacheParams PrecacheParams;
+	PrecacheParams.SetMobility(EComponentMobility::Movable);
+	for (const FString& VertexFactoryTypeName : VertexFactoryTypeNames)
+	{
+		//Niagara が無効な場合など、モジュールが読み込まれていない頂点ファクトリは無視する
+		const FVertexFactoryType* VertexFactoryType = FVertexFactoryType::GetVFByName(FHashedName(VertexFactoryTypeName));
+		if (!VertexFactoryType)
+		{
+			continue;
+		}
+		FLiquidPSOWarmupRequest& Request = Requests.AddDefaulted_GetRef();
+		Request.Material = FSoftObjectPath(Material);
+		Request.Permutation = Permutation;
+		Request.VertexFactory = FName(VertexFactoryTypeName);
+		if (!bCanPrecache || !VertexFactoryType->SupportsPSOPrecaching())
+		{
+			continue;
+		}
+		FPSOPrecacheVertexFactoryDataList VertexFactoryDataList;
+		VertexFactoryDataList.Add(FPSOPrecacheVertexFactoryData(VertexFactoryType));
+		TArray<FMaterialPSOPrecacheRequestID> RequestIDs;
+		const FGraphEventArray Tasks = Material->PrecachePSOs(VertexFactoryDataList, PrecacheParams, EPSOPrecachePriority::High, RequestIDs);
+		Request.NumPSOTasks = Tasks.Num();
+		Request.bPrecached = true;
+		PendingPSOTasks.Append(Tasks);
+	}
+}
+
+bool ULiquidPSOWarmupSubsystem::Tick(float DeltaTime)
+{
+	PendingPSOTasks.RemoveAllSwap([](const FGraphEventRef& Task)
+	{
+		return !Task.IsValid() || Task->IsComplete();
+	});
+	SET_DWORD_STAT(STAT_LiquidPSOWarmupTasks, PendingPSOTasks.Num());
+	if (PendingPSOTasks.Num() > 0)
+	{
+		return true;
+	}
+	TickerHandle.Reset();
+	CompleteWarmup();
+	return false;
+}
+
+void ULiquidPSOWarmupSubsystem::CompleteWarmup()
+{
+	bRunning = false;
+	bComplete = true;
+	WarmupSeconds = static_cast<float>(FPlatformTime::Seconds() - StartTime);
+	for (TSharedPtr<FStreamableHandle>* Handle : {&TablesHandle, &MaterialsHandle})
+	{
+		if (Handle->IsValid())
+		{
+			(*Handle)->ReleaseHandle();
+			Handle->Reset();
+		}
+	}
+	UE_LOG(LogTemp, Log, TEXT("[ULiquidPSOWarmupSubsystem] PSO Warmup Completed. Permutations: %d Tasks: %d Time: %.3f sec"),
+		Requests.Num(), NumPSOTasks, WarmupSeconds);
+	OnPSOWarmupCompleted.Broadcast();
+}
+
+float ULiquidPSOWarmupSubsystem::GetWarmupProgress() const
+{
+	if (bComplete)
+	{
+		return 1.0f;
+	}
+	if (!bRunning)
+	{
+		return .0f;
+	}
+	if (!bMaterialsLoaded)
+	{
+		return MaterialsHandle.IsValid() ? .5f * MaterialsHandle->GetProgress() : .0f;
+	}
+	if (NumPSOTasks == 0)
+	{
+		return 1.0f;
+	}
+	return .5f + .5f * static_cast<float>(NumPSOTasks - PendingPSOTasks.Num()) / static_cast<float>(NumPSOTasks);
+}
+
+FString ULiquidPSOWarmupSubsystem::GetPermutationName(const UMaterialInterface* Material)
+{
+	//"BLEND_Masked" → "Masked"
+	auto TrimPrefix = [](FString Name)
+	{
+		int32 Index = INDEX_NONE;
+		if (Name.FindChar(TEXT('_'), Index))
+		{
+			Name.RightChopInline(Index + 1);
+		}
+		return Name;
+	};
+	const UMaterial* BaseMaterial = Material->GetMaterial();
+	if (BaseMaterial && BaseMaterial->MaterialDomain != MD_Surface)
+	{
+		return TrimPrefix(StaticEnum<EMaterialDomain>()->GetNameStringByValue(BaseMaterial->MaterialDomain));
+	}
+	const FString ShadingModel = TrimPrefix(StaticEnum<EMaterialShadingModel>()->GetNameStringByValue(Material->GetShadingModels().GetFirstShadingModel()));
+	const FString BlendMode = TrimPrefix(StaticEnum<EBlendMode>()->GetNameStringByValue(Material->GetBlendMode()));
+	return ShadingModel + TEXT(" ") + BlendMode;
+}
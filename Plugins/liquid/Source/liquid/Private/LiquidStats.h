@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+
+/**
+ * liquid プラグインの統計情報 (stat liquid で表示)
+ */
+DECLARE_STATS_GROUP(TEXT("Liquid"), STATGROUP_Liquid, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("PostActorTick"), STAT_LiquidPostActorTick, STATGROUP_Liquid, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Task Tick"), STAT_LiquidTaskTick, STATGROUP_Liquid, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Evaluate Curves"), STAT_LiquidEvaluateCurves, STATGROUP_Liquid, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Acquire MID"), STAT_LiquidAcquireMID, STATGROUP_Liquid, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Load Callback"), STAT_LiquidLoadCallback, STATGROUP_Liquid, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Display Spawn"), STAT_LiquidDisplaySpawn, STATGROUP_Liquid, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Display Release"), STAT_LiquidDisplayRelease, STATGROUP_Liquid, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Active Tasks"), STAT_LiquidActiveTasks, STATGROUP_Liquid, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Cached Materials"), STAT_LiquidCachedMaterials, STATGROUP_Liquid, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shared Assets"), STAT_LiquidSharedAssets, STATGROUP_Liquid, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("PSO Warmup Tasks"), STAT_LiquidPSOWarmupTasks, STATGROUP_Liquid, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Load Retries"), STAT_LiquidLoadRetries, STATGROUP_Liquid, );
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Effect Bundles"), STAT_LiquidEffectBundleMemory, STATGROUP_Liquid, );
+
+/**
+ * CSV プロファイラのカテゴリ (csvprofile start / -csvCaptureFrames で出力)
+ */
+CSV_DECLARE_CATEGORY_EXTERN(Liquid);
+
+/**
+ * エフェクト単位のイベント(再生・終了・破棄・ロード)を Unreal Insights のタイムラインへ出力するチャンネル
+ * 有効化: -trace=cpu,liquid または Trace.Enable liquid
+ */
+UE_TRACE_CHANNEL_EXTERN(LiquidChannel);
+
+#if CPUPROFILERTRACE_ENABLED
+/**
+ * @brief LiquidChannel が有効な場合のみ、"Liquid.<EventName> <EffectID>" という名前の長さ 0 のイベントを出力する。
+ * 名前の文字列生成もチャンネルが無効な場合は行わない。
+ * 1つの文として展開するため、if / else の中でもそのまま使用できる。
+ */
+#define LIQUID_TRACE_EVENT(EventName, EffectID) \
+	do \
+	{ \
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(LiquidChannel)) \
+		{ \
+			TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(*FString::Printf(TEXT("Liquid.%s %s"), TEXT(EventName), *(EffectID).ToString()), LiquidChannel); \
+		} \
+	} while (0)
+#else
+#define LIQUID_TRACE_EVENT(EventName, EffectID) do {} while (0)
+#endif
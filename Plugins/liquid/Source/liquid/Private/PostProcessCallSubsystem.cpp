@@ -2,19 +2,72 @@
 
 
 #include "PostProcessCallSubsystem.h"
+#include "LiquidStats.h"
 #include "Kismet/GameplayStatics.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Engine/GameInstance.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
 #include "Engine/AssetManager.h"
 #include "Engine/StreamableManager.h"
+#include "Materials/MaterialInstanceDynamic.h"
+#include "Curves/CurveFloat.h"
+#include "Algo/BinarySearch.h"
 
-FTransientPostProcessTask::FTransientPostProcessTask(const FName& EffectID,const FTransientPostProcessConfig* ConfigPtr, UPostProcessCallSubsystem* Owner)
-	: PostProcessConfig(ConfigPtr), Owner(Owner), EffectID(EffectID)
+void FPostProcessCurveTable::Bake(const UCurveFloat* Curve, int32 Resolution)
 {
-	check(Owner);
+	Samples.Reset();
+	LastSampleIndex = .0f;
+	if (!Curve)
+	{
+		return;
+	}
+	Resolution = FMath::Max(Resolution, 2);
+	//note: Evaluate() で Index + 1 を参照するため末尾に最終サンプルを複製しておく
+	Samples.SetNumUninitialized(Resolution + 1);
+	const float Step = 1.0f / static_cast<float>(Resolution - 1);
+	for (int32 Index = 0; Index < Resolution; ++Index)
+	{
+		Samples[Index] = Curve->GetFloatValue(static_cast<float>(Index) * Step);
+	}
+	Samples[Resolution] = Samples[Resolution - 1];
+	LastSampleIndex = static_cast<float>(Resolution - 1);
+}
+
+#if !UE_BUILD_SHIPPING
+float FPostProcessCurveTable::MeasureMaxError(const UCurveFloat* Curve, int32 NumSteps) const
+{
+	if (!Curve || !IsBaked() || NumSteps < 1)
+	{
+		return .0f;
+	}
+	float MaxError = .0f;
+	for (int32 Step = 0; Step <= NumSteps; ++Step)
+	{
+		const float Time = static_cast<float>(Step) / static_cast<float>(NumSteps);
+		MaxError = FMath::Max(MaxError, FMath::Abs(Evaluate(Time) - Curve->GetFloatValue(Time)));
+	}
+	return MaxError;
+}
+
+float FPostProcessCurveTable::GetErrorTolerance(const UCurveFloat* Curve)
+{
+	float MinValue = .0f;
+	float MaxValue = .0f;
+	if (Curve)
+	{
+		Curve->GetValueRange(MinValue, MaxValue);
+	}
+	return ErrorToleranceRatio * FMath::Max(MaxValue - MinValue, 1.0f);
 }
+#endif
 
-FString FTransientPostProcessTask::GetReferencerName() const
+FTransientPostProcessTask::FTransientPostProcessTask(const FName& EffectID,const FTransientPostProcessConfig* ConfigPtr, UPostProcessCallSubsystem* Owner,
+	const TWeakObjectPtr<APlayerCameraManager>& TargetCamera, TSharedPtr<const FTransientPostProcessRowCache> RowCache)
+	: PostProcessConfig(ConfigPtr), Owner(Owner), RowCache(MoveTemp(RowCache)), TargetCamera(TargetCamera), EffectID(EffectID)
 {
-	return TEXT("TransientPostProcessTask");
+	check(Owner);
 }
 
 void FTransientPostProcessTask::AddReferencedObjects(FReferenceCollector& Collector)
@@ -28,7 +81,7 @@ bool FTransientPostProcessTask::Activate(UMaterialInstance* OwnerMaterial)
 	{
 		return false;
 	}
-	InitializeOverrideSettings();
+	ResolveScalarParameters();
 	return true;
 }
 
@@ -39,49 +92,93 @@ bool FTransientPostProcessTask::Activate(UMaterialInstance* OwnerMaterial, const
 		return false;
 	}
 	InitFunction(MaterialInstanceDynamic);
-	InitializeOverrideSettings();
+	ResolveScalarParameters();
 	return true;
 }
 
+void FTransientPostProcessTask::Restart()
+{
+	ElapsedTime = .0f;
+}
+
+void FTransientPostProcessTask::Restart(const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction)
+{
+	ElapsedTime = .0f;
+	//note: InitFunction はカーブで制御しないパラメータにのみ反映される。カーブで制御するパラメータは次の Tick で上書きされるため再解決は不要
+	InitFunction(MaterialInstanceDynamic);
+}
+
 /**
  * @details
  * - 経過時間を更新し、NormalizedElapsedTime(0‑1) を算出。
- * - ControlParameters で指定された MID のスカラーをカーブで更新。
- * - AddCachedPPBlend() で PostProcess をカメラへ適用。
- * - 寿命(ElapsedTime >= Duration) を迎えたら Cleanup() し Finish を返す。
+ * - ControlParameters で指定された MID のスカラーをカーブで更新。(ベイク済みの場合はテーブルを参照)
+ * - 現在の Weight を設定した MID を OutBlendables へ追加。(カメラへの適用はサブシステムがまとめて行う)
+ * - 寿命(ElapsedTime >= Duration) を迎えたら Finish を返す。
+ *   このフレームの Blendable として MID を追加済みのため、ここでは Cleanup() しない。
+ *   (プールへ返却するとパラメータがクリアされ、最終フレームが親マテリアルの値で描画される)
  */
-PostProcessTaskTickResult FTransientPostProcessTask::Tick(APlayerCameraManager* CameraManager, float DeltaTime)
+PostProcessTaskTickResult FTransientPostProcessTask::Tick(FWeightedBlendables& OutBlendables, float DeltaTime)
 {
+	SCOPE_CYCLE_COUNTER(STAT_LiquidTaskTick);
 	ElapsedTime += DeltaTime;
 	float NormalizedElapsedTime = ElapsedTime / PostProcessConfig->Duration;
 	NormalizedElapsedTime = FMath::Clamp(NormalizedElapsedTime, 0.0f, 1.0f);
-	for (const auto& Parameters : PostProcessConfig->ControlParameters)
+	float CurrentWeight = (RowCache && RowCache->bBaked)
+		? EvaluateBakedCurves(NormalizedElapsedTime)
+		: EvaluateCurves(NormalizedElapsedTime);
+	CurrentWeight = FMath::Clamp(CurrentWeight, 0.0f, 1.0f);
+	//note: AddCachedPPBlend の Weight は Blendable 毎の Weight と乗算されるため、Blendable 側に Weight を持たせても結果は同じ
+	if (CurrentWeight > .0f)
+	{
+		OutBlendables.Array.Emplace(CurrentWeight, MaterialInstanceDynamic);
+	}
+	
+	if ( ElapsedTime >= PostProcessConfig->Duration)
+	{
+		return PostProcessTaskTickResult::Finish;
+	}
+	return PostProcessTaskTickResult::Progress;
+
+}
+
+float FTransientPostProcessTask::EvaluateCurves(float NormalizedElapsedTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LiquidEvaluateCurves);
+	const TArray<FPostProcessControlParams>& ControlParameters = PostProcessConfig->ControlParameters;
+	for (int32 Index = 0; Index < ScalarParameterIndices.Num(); ++Index)
 	{
-		if (Parameters.MaterialParameterName ==  NAME_None)
+		const int32 ParameterIndex = ScalarParameterIndices[Index];
+		if (ParameterIndex == INDEX_NONE)
 		{
 			continue;
 		}
-		if (Parameters.NormalizedFloatCurve)
-		{
-			const float Value = Parameters.NormalizedFloatCurve->GetFloatValue(NormalizedElapsedTime);
-			MaterialInstanceDynamic->SetScalarParameterValue(Parameters.MaterialParameterName, Value);
-		}
+		const float Value = ControlParameters[Index].NormalizedFloatCurve->GetFloatValue(NormalizedElapsedTime);
+		MaterialInstanceDynamic->SetScalarParameterByIndex(ParameterIndex, Value);
 	}
-	float CurrentWeight = PostProcessConfig->InitialWeight;
 	if (PostProcessConfig->NormalizedWeightCurve)
 	{
-		CurrentWeight = PostProcessConfig->NormalizedWeightCurve->GetFloatValue(NormalizedElapsedTime);
+		return PostProcessConfig->NormalizedWeightCurve->GetFloatValue(NormalizedElapsedTime);
 	}
-	CurrentWeight = FMath::Clamp(CurrentWeight, 0.0f, 1.0f);
-	CameraManager->AddCachedPPBlend(OverrideSettings, CurrentWeight, VTBlendOrder_Override);
-	
-	if ( ElapsedTime >= PostProcessConfig->Duration)
+	return PostProcessConfig->InitialWeight;
+}
+
+float FTransientPostProcessTask::EvaluateBakedCurves(float NormalizedElapsedTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LiquidEvaluateCurves);
+	//note: ParameterCurves は ControlParameters と同じ並び。更新対象外の要素は ScalarParameterIndices が INDEX_NONE
+	const TArray<FPostProcessCurveTable>& ParameterCurves = RowCache->ParameterCurves;
+	for (int32 Index = 0; Index < ScalarParameterIndices.Num(); ++Index)
 	{
-		Cleanup();
-		return PostProcessTaskTickResult::Finish;
+		const int32 ParameterIndex = ScalarParameterIndices[Index];
+		if (ParameterIndex == INDEX_NONE)
+		{
+			continue;
+		}
+		MaterialInstanceDynamic->SetScalarParameterByIndex(ParameterIndex, ParameterCurves[Index].Evaluate(NormalizedElapsedTime));
 	}
-	return PostProcessTaskTickResult::Progress;
-
+	return RowCache->WeightCurve.IsBaked()
+		? RowCache->WeightCurve.Evaluate(NormalizedElapsedTime)
+		: PostProcessConfig->InitialWeight;
 }
 
 bool FTransientPostProcessTask::IsScheduleDeleteTask(float CurrentFrameDeltaTime) const
@@ -91,7 +188,7 @@ bool FTransientPostProcessTask::IsScheduleDeleteTask(float CurrentFrameDeltaTime
 
 bool FTransientPostProcessTask::CreateMaterialInstanceDynamic(UMaterialInstance* OwnerMaterial)
 {
-	MaterialInstanceDynamic = UMaterialInstanceDynamic::Create(OwnerMaterial,Owner);
+	MaterialInstanceDynamic = Owner->AcquireMaterialInstanceDynamic(EffectID, OwnerMaterial);
 	if (!MaterialInstanceDynamic)
 	{
 		UE_LOG(LogTemp, Error, TEXT("[FPostProcessOverrideTask] Failed Create Material Instance Dynamic"));
@@ -102,293 +199,1300 @@ bool FTransientPostProcessTask::CreateMaterialInstanceDynamic(UMaterialInstance*
 
 void FTransientPostProcessTask::Cleanup()
 {
-	OverrideSettings.WeightedBlendables.Array.Empty();
-	// MID を即座に GC 対象へ
+	// MID は破棄せずプールへ返却して再利用する
 	if (MaterialInstanceDynamic)
 	{
-		MaterialInstanceDynamic->MarkAsGarbage();
+		Owner->ReleaseMaterialInstanceDynamic(EffectID, *PostProcessConfig, MaterialInstanceDynamic);
 		MaterialInstanceDynamic = nullptr;
 	}
 }
 
-void FTransientPostProcessTask::InitializeOverrideSettings()
+/**
+ * @details
+ * 名前検索は Activate 時の一度だけ行い、Tick では解決済みのインデックスで MID を更新する。
+ * マテリアルに存在しないパラメータ(ロード時に報告済み)とカーブ未設定のパラメータは INDEX_NONE にしてスキップする。
+ * カーブで制御するパラメータは常にカーブの値が使われ、ここで curve(0) が設定される(InitFunction の値は上書きされる)。
+ * InitFunction が反映されるのはカーブで制御しないパラメータのみ。
+ */
+void FTransientPostProcessTask::ResolveScalarParameters()
 {
-	FWeightedBlendable Blendable;
-	Blendable.Object = MaterialInstanceDynamic;
-	Blendable.Weight = 1.0f;
-	OverrideSettings.WeightedBlendables.Array.Add(Blendable);
+	const TArray<FPostProcessControlParams>& ControlParameters = PostProcessConfig->ControlParameters;
+	ScalarParameterIndices.Init(INDEX_NONE, ControlParameters.Num());
+	for (int32 Index = 0; Index < ControlParameters.Num(); ++Index)
+	{
+		const FPostProcessControlParams& Parameters = ControlParameters[Index];
+		if (Parameters.MaterialParameterName == NAME_None || !Parameters.NormalizedFloatCurve)
+		{
+			continue;
+		}
+		if (RowCache && RowCache->ValidParameterMask.IsValidIndex(Index) && !RowCache->ValidParameterMask[Index])
+		{
+			continue;
+		}
+		int32 ParameterIndex = INDEX_NONE;
+		const float InitialValue = Parameters.NormalizedFloatCurve->GetFloatValue(.0f);
+		if (MaterialInstanceDynamic->InitializeScalarParameterAndGetIndex(Parameters.MaterialParameterName, InitialValue, ParameterIndex))
+		{
+			ScalarParameterIndices[Index] = ParameterIndex;
+		}
+	}
 }
 
 /**
  * @brief サブシステム初期化。
- * - Datatable をロード
  * - PostActorTick デリゲート登録
- * - Datatable 行毎にマテリアルを非同期ロード開始
+ * - PostProcessTables に設定された Datatable の非同期ロード開始
  */
 void UPostProcessCallSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
-	PostProcessTable = Cast<UDataTable>(StaticLoadObject(UDataTable::StaticClass(), nullptr, TableAssetPath));
-	TransientTasks.Reserve(TransientPostProcessCapacity);
-	if(!PostProcessTable)
-	{
-		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Data Table Load Failed"));
-		return;
-	}
-	
+	InitializeStartTime = FPlatformTime::Seconds();
+	TransientTasks.Reserve(FMath::Max(MaxTransientTasks, 1));
 	PostActorTickHandle = FWorldDelegates::OnWorldPostActorTick.AddUObject(
 		this, &UPostProcessCallSubsystem::OnWorldPostActorTick);
+	PostLoginHandle = FGameModeEvents::GameModePostLoginEvent.AddUObject(
+		this, &UPostProcessCallSubsystem::OnGameModePostLogin);
+	LogoutHandle = FGameModeEvents::GameModeLogoutEvent.AddUObject(
+		this, &UPostProcessCallSubsystem::OnGameModeLogout);
 
-	TArray<FName> RowNames = PostProcessTable->GetRowNames();
-	CachedMaterials.Reserve(RowNames.Num());
-	for (auto& Name : RowNames)
+	//note: World 生成をブロックしないようにテーブルも非同期でロードする
+	TArray<FSoftObjectPath> TablePaths;
+	GatherPostProcessTablePaths(TablePaths);
+	if (TablePaths.IsEmpty())
 	{
-		LoadMaterialQueue.Enqueue(MoveTemp(Name));
+		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] PostProcessTables is not configured"));
+		return;
 	}
-	FName FirstLoadID;
-	LoadMaterialQueue.Dequeue(FirstLoadID);
-	LoadPostProcessMaterialAsync(FirstLoadID);
+	FStreamableManager& Manager = UAssetManager::GetStreamableManager();
+	TableLoadingHandle = Manager.RequestAsyncLoad(
+		MoveTemp(TablePaths),
+		FStreamableDelegate::CreateUObject(this, &UPostProcessCallSubsystem::OnPostProcessTablesLoaded));
+	InitializeSeconds = static_cast<float>(FPlatformTime::Seconds() - InitializeStartTime);
 }
 
 /**
- * @brief Datatable 行に紐付くマテリアルを非同期ロード。(逐次処理)
- * @param EffectID 行ID
+ * @brief PostProcessTables のうち、このサブシステムの World で使用するテーブルのパスを設定順に収集。
  */
-void UPostProcessCallSubsystem::LoadPostProcessMaterialAsync(const FName& EffectID)
+void UPostProcessCallSubsystem::GatherPostProcessTablePaths(TArray<FSoftObjectPath>& OutTablePaths) const
 {
-	const FTransientPostProcessConfig* Row = PostProcessTable->FindRow<FTransientPostProcessConfig>(EffectID, TEXT("UPostProcessCallSubsystem::Initialize"));
-	if (!Row || Row->Material.IsNull())
+	const UWorld* World = GetWorld();
+	const FString WorldPackageName = World ? UWorld::RemovePIEPrefix(World->GetOutermost()->GetName()) : FString();
+	for (const FTransientPostProcessTableEntry& Entry : PostProcessTables)
 	{
-		UE_LOG(LogTemp, Error,
-		TEXT("[UPostProcessCallSubsystem::Initialize] Row %s has null Material"), *EffectID.ToString());
-		return;;
-	}
-
-	FStreamableManager& Manager = UAssetManager::GetStreamableManager();
-	CurrentLoadingHandle = Manager.RequestAsyncLoad(
-	Row->Material.ToSoftObjectPath(),
-		FStreamableDelegate::CreateLambda([this,Row, EffectID]()
+		if (Entry.Table.IsNull())
 		{
-			UMaterialInstance* LoadedMaterial = Row->Material.Get();
-			bool IsSuccessful = Row->Material.IsValid() && LoadedMaterial != nullptr;
-			if (!IsSuccessful)
-			{
-				int32& RetryCount = LoadRetryCounts.FindOrAdd(EffectID);
-				if (++RetryCount <= MaxLoadRetryCount)
-				{
-					UE_LOG(LogTemp, Warning,
-						TEXT("[PostProcessCallSubsystem] Retry %d / %d : %s"),
-						RetryCount, MaxLoadRetryCount, *EffectID.ToString());
-					LoadPostProcessMaterialAsync(EffectID);
-					return;
-				}
-			}
-			if (LoadedMaterial)
-			{
-				CachedMaterials.Add(EffectID, LoadedMaterial);
-				UE_LOG(LogTemp, Log,
-				   TEXT("[UPostProcessCallSubsystem::Initialize] Loaded PostProcess Material for %s"), *EffectID.ToString());
-			}
-			else
-			{
-				UE_LOG(LogTemp, Error,
-				   TEXT("[UPostProcessCallSubsystem::Initialize] Failed to load PostProcess Material for %s"),
-				   *EffectID.ToString());
-			}
-
-			if (!LoadMaterialQueue.IsEmpty())
+			continue;
+		}
+		const bool bMatchMap = Entry.Maps.IsEmpty() || Entry.Maps.ContainsByPredicate(
+			[&WorldPackageName](const TSoftObjectPtr<UWorld>& Map)
 			{
-				FName NextID;
-				LoadMaterialQueue.Dequeue(NextID);
-				LoadPostProcessMaterialAsync(NextID);
-			}
-		}));
-}
-
-float UPostProcessCallSubsystem::GetEffectiveDeltaSeconds(const UWorld* InWorld)
-{
-	return (InWorld != nullptr)? InWorld->GetDeltaSeconds() : FApp::GetDeltaTime();   // World が分かるならその Δt: FApp::GetDeltaTime();
+				return Map.ToSoftObjectPath().GetLongPackageName() == WorldPackageName;
+			});
+		if (bMatchMap)
+		{
+			OutTablePaths.AddUnique(Entry.Table.ToSoftObjectPath());
+		}
+	}
 }
 
-/**
- * サブシステムの終了処理。デリゲート登録を解除。
- */
-void UPostProcessCallSubsystem::Deinitialize()
+void UPostProcessCallSubsystem::GatherConfiguredPostProcessTablePaths(TArray<FSoftObjectPath>& OutTablePaths)
 {
-	if (CurrentLoadingHandle.IsValid())
+	for (const FTransientPostProcessTableEntry& Entry : GetDefault<UPostProcessCallSubsystem>()->PostProcessTables)
 	{
-		CurrentLoadingHandle->CancelHandle();
+		if (!Entry.Table.IsNull())
+		{
+			OutTablePaths.AddUnique(Entry.Table.ToSoftObjectPath());
+		}
 	}
-	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
 }
 
 /**
- * データテーブルから指定IDの行を取得し、該当するエフェクトを実行
- *
- * @param EffectID データテーブル内の行ID
+ * @brief テーブルのロード完了処理。
+ * - 設定順に行をマージ(同名の行は後のテーブルで上書き)
+ * - LoadPolicy が Eager の行を Priority 毎のバッチにまとめてマテリアルを非同期ロード開始
+ * - テーブルのロード前に呼ばれた再生要求を処理
  */
-bool UPostProcessCallSubsystem::PlayTransientPostProcess(const FName& EffectID)
+void UPostProcessCallSubsystem::OnPostProcessTablesLoaded()
 {
-	if(!PostProcessTable)
+	SCOPE_CYCLE_COUNTER(STAT_LiquidLoadCallback);
+	CSV_SCOPED_TIMING_STAT(Liquid, LoadCallback);
+	TableLoadingHandle.Reset();
+	TableLoadSeconds = static_cast<float>(FPlatformTime::Seconds() - InitializeStartTime);
+
+	TArray<FSoftObjectPath> TablePaths;
+	GatherPostProcessTablePaths(TablePaths);
+	for (const FSoftObjectPath& TablePath : TablePaths)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] PostProcessTable is nullptr"));
-		return false;
+		UDataTable* Table = Cast<UDataTable>(TablePath.ResolveObject());
+		if (!Table)
+		{
+			UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Data Table Load Failed: %s"), *TablePath.ToString());
+			continue;
+		}
+		const UScriptStruct* RowStruct = Table->GetRowStruct();
+		if (!RowStruct || !RowStruct->IsChildOf(FTransientPostProcessConfig::StaticStruct()))
+		{
+			UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Data Table Row Struct is not FTransientPostProcessConfig: %s"), *TablePath.ToString());
+			continue;
+		}
+		PostProcessTableAssets.Add(Table);
+		for (const TPair<FName, uint8*>& Row : Table->GetRowMap())
+		{
+			if (MergedRows.Contains(Row.Key))
+			{
+				UE_LOG(LogTemp, Log, TEXT("[UPostProcessCallSubsystem] Row %s is overridden by %s"), *Row.Key.ToString(), *Table->GetName());
+			}
+			MergedRows.Add(Row.Key, reinterpret_cast<const FTransientPostProcessConfig*>(Row.Value));
+		}
 	}
-	if(const FTransientPostProcessConfig* Row = PostProcessTable->FindRow<FTransientPostProcessConfig>(EffectID, TEXT("PostProcessCallSubsystem")))
+	bTablesLoaded = true;
+	UE_LOG(LogTemp, Log,
+		TEXT("[UPostProcessCallSubsystem] PostProcess Tables Loaded. Tables: %d Rows: %d Initialize: %.3f ms TableLoad: %.3f sec"),
+		PostProcessTableAssets.Num(), MergedRows.Num(), InitializeSeconds * 1000.0f, TableLoadSeconds);
+
+	//note: 同一 Priority の行を 1 リクエストにまとめ、Priority をそのまま非同期ロード優先度として使用する
+	TMap<int32, TArray<FName>> EffectIDsByPriority;
+	for (const auto& Pair : MergedRows)
 	{
-	
-		if (Row->Duration <= .0f)
+		const FName& EffectID = Pair.Key;
+		const FTransientPostProcessConfig& Row = *Pair.Value;
+		if (Row.Material.IsNull())
 		{
-			UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Duration is 0 EffectID: %s "), *EffectID.ToString());
-			return false;
+			UE_LOG(LogTemp, Error,
+				TEXT("[UPostProcessCallSubsystem::Initialize] Row %s has null Material"), *EffectID.ToString());
+			continue;
+		}
+		if (Row.LoadPolicy != ETransientPostProcessLoadPolicy::Eager)
+		{
+			continue;
 		}
-		return BeginTransientPostProcess(EffectID, Row);
+		EffectIDsByPriority.FindOrAdd(Row.Priority).Add(EffectID);
+		LoadingEffectIDs.Add(EffectID);
 	}
-	else
+	EffectIDsByPriority.KeySort(TGreater<int32>());
+	CachedMaterials.Reserve(MergedRows.Num());
+	PendingLoadBatches.Reserve(EffectIDsByPriority.Num());
+	for (auto& Pair : EffectIDsByPriority)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Not Found ID: %s "), *EffectID.ToString());	
+		FPostProcessMaterialLoadBatch& Batch = PendingLoadBatches.AddDefaulted_GetRef();
+		Batch.Priority = Pair.Key;
+		Batch.EffectIDs = MoveTemp(Pair.Value);
+	}
+	PumpMaterialLoadBatches();
+
+	TArray<FPendingTransientPostProcessPlay> PlaysBeforeTablesLoaded = MoveTemp(PendingPlays);
+	PendingPlays.Reset();
+	for (const FPendingTransientPostProcessPlay& Play : PlaysBeforeTablesLoaded)
+	{
+		//note: 適用先のカメラが待機中に破棄された場合は再生しない
+		if (Play.TargetCamera.IsExplicitlyNull() || Play.TargetCamera.IsValid())
+		{
+			PlayTransientPostProcess(Play.EffectID, Play.TargetCamera.Get());
+		}
 	}
-	return false;
 }
 
-bool UPostProcessCallSubsystem::PlayTransientPostProcess(const FName& EffectID,
-	const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction)
+const FTransientPostProcessConfig* UPostProcessCallSubsystem::FindConfig(const FName& EffectID) const
 {
-	if(!PostProcessTable)
+	const FTransientPostProcessConfig* const* Found = MergedRows.Find(EffectID);
+	return Found ? *Found : nullptr;
+}
+
+bool UPostProcessCallSubsystem::RequestMaterialLoad(const FName& EffectID, const FTransientPostProcessConfig& Config)
+{
+	if (LoadingEffectIDs.Contains(EffectID))
+	{
+		return true;
+	}
+	if (CachedMaterials.Contains(EffectID) || Config.Material.IsNull())
 	{
-		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] PostProcessTable is nullptr"));
 		return false;
 	}
-	if(const FTransientPostProcessConfig* Row = PostProcessTable->FindRow<FTransientPostProcessConfig>(EffectID, TEXT("PostProcessCallSubsystem")))
+	if (const int32* RetryCount = LoadRetryCounts.Find(EffectID); RetryCount && *RetryCount > MaxLoadRetryCount)
 	{
-		if (Row->Duration <= .0f)
+		return false;
+	}
+	LoadingEffectIDs.Add(EffectID);
+	FPostProcessMaterialLoadBatch& Batch = PendingLoadBatches.AddDefaulted_GetRef();
+	Batch.Priority = Config.Priority;
+	Batch.EffectIDs.Add(EffectID);
+	PumpMaterialLoadBatches();
+	return true;
+}
+
+void UPostProcessCallSubsystem::PreloadTransientPostProcessByTag(FName Tag)
+{
+	if (!bTablesLoaded || Tag == NAME_None)
+	{
+		return;
+	}
+	for (const auto& Pair : MergedRows)
+	{
+		const FTransientPostProcessConfig& Row = *Pair.Value;
+		if (Row.LoadPolicy == ETransientPostProcessLoadPolicy::PreloadByTag && Row.PreloadTag == Tag)
 		{
-			UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Duration is 0 EffectID: %s "), *EffectID.ToString());
-			return false;
+			RequestMaterialLoad(Pair.Key, Row);
 		}
-		return BeginTransientPostProcess(EffectID, Row, InitFunction);
 	}
-	return false;
 }
 
-bool UPostProcessCallSubsystem::IsPlayingTransientPostProcess(const FName& EffectID, const UWorld* InWorld) const
+/**
+ * @brief 待機中のロードバッチを同時実行数(MaxConcurrentMaterialLoads)の範囲で発行する。
+ * 全てのバッチが完了したら Ready 状態へ移行する。
+ */
+void UPostProcessCallSubsystem::PumpMaterialLoadBatches()
 {
-	auto ExistTask = TransientTasks.FindByPredicate(
-		[&EffectID](const TUniquePtr<FTransientPostProcessTask>& Task)
-		{
-			return Task->GetEffectID() == EffectID;
-		});
-	if (!ExistTask)
+	const int32 MaxInFlight = FMath::Max(MaxConcurrentMaterialLoads, 1);
+	while (!PendingLoadBatches.IsEmpty() && InFlightLoadBatches.Num() < MaxInFlight)
 	{
-		return false;
+		FPostProcessMaterialLoadBatch Batch = MoveTemp(PendingLoadBatches[0]);
+		PendingLoadBatches.RemoveAt(0, EAllowShrinking::No);
+
+		TArray<FSoftObjectPath> MaterialPaths;
+		MaterialPaths.Reserve(Batch.EffectIDs.Num());
+		for (const FName& EffectID : Batch.EffectIDs)
+		{
+			if (const FTransientPostProcessConfig* Row = FindConfig(EffectID))
+			{
+				MaterialPaths.Add(Row->Material.ToSoftObjectPath());
+			}
+		}
+		if (MaterialPaths.IsEmpty())
+		{
+			continue;
+		}
+		const int32 BatchID = NextLoadBatchID++;
+		const int32 Priority = Batch.Priority;
+		//note: ロード済みアセットのみの場合にデリゲートが即時実行されても良いように、先に登録してからリクエストする
+		InFlightLoadBatches.Add(BatchID, MoveTemp(Batch));
+
+		FStreamableManager& Manager = UAssetManager::GetStreamableManager();
+		TSharedPtr<FStreamableHandle> Handle = Manager.RequestAsyncLoad(
+			MoveTemp(MaterialPaths),
+			FStreamableDelegate::CreateUObject(this, &UPostProcessCallSubsystem::OnMaterialLoadBatchCompleted, BatchID),
+			Priority);
+		if (FPostProcessMaterialLoadBatch* InFlight = InFlightLoadBatches.Find(BatchID))
+		{
+			InFlight->Handle = MoveTemp(Handle);
+		}
 	}
-	if (ExistTask->IsValid())
+
+	if (!bMaterialsReady && PendingLoadBatches.IsEmpty() && InFlightLoadBatches.IsEmpty())
 	{
-		float Delta = GetEffectiveDeltaSeconds(InWorld);
-		return !(*ExistTask)->IsScheduleDeleteTask(Delta);
+		bMaterialsReady = true;
+		TimeToReadySeconds = static_cast<float>(FPlatformTime::Seconds() - InitializeStartTime);
+		UE_LOG(LogTemp, Log,
+			TEXT("[UPostProcessCallSubsystem] PostProcess Materials Ready. Loaded: %d TimeToReady: %.3f sec"),
+			CachedMaterials.Num(), TimeToReadySeconds);
+		OnTransientPostProcessReady.Broadcast();
 	}
-	return false;
 }
 
 /**
- * タスクを初期化・有効化し、実行中タスクリストに追加
- *
- * @param EffectID DataTable上のID
- * @param Config 実行するエフェクトの設定情報
+ * @brief ロードバッチ完了時の処理。ロードに失敗した行は MaxLoadRetryCount 回まで再度バッチに積み直す。
+ * @param BatchID 完了したバッチの ID
  */
-bool UPostProcessCallSubsystem::BeginTransientPostProcess(const FName& EffectID, const FTransientPostProcessConfig* Config)
+void UPostProcessCallSubsystem::OnMaterialLoadBatchCompleted(int32 BatchID)
 {
-	UMaterialInstance* LoadedMat = GetLoadedMaterial(EffectID);
-	if (!LoadedMat)
+	SCOPE_CYCLE_COUNTER(STAT_LiquidLoadCallback);
+	CSV_SCOPED_TIMING_STAT(Liquid, LoadCallback);
+	FPostProcessMaterialLoadBatch Batch;
+	if (!InFlightLoadBatches.RemoveAndCopyValue(BatchID, Batch))
 	{
-		UE_LOG(LogTemp, Error,
-			TEXT("[UPostProcessCallSubsystem::BeginTransientPostProcess] Material for %s is not loaded yet. PostProcess call aborted."),
-			*EffectID.ToString());
-		return false;
+		return;
 	}
-	auto InitTask =	MakeUnique<FTransientPostProcessTask>(EffectID, Config, this);
-	if (InitTask->Activate(LoadedMat))
+	TArray<FName> RetryEffectIDs;
+	for (const FName& EffectID : Batch.EffectIDs)
 	{
-		TransientTasks.Emplace(MoveTemp(InitTask));
-		//memo: 各TaskのTickは降順に実行されるのでここでも降順に実行することで結果的に昇順のタスク実行になるようにする
-		TransientTasks.Sort([](const TUniquePtr<FTransientPostProcessTask>& A, const TUniquePtr<FTransientPostProcessTask>& B)
+		const FTransientPostProcessConfig* Row = FindConfig(EffectID);
+		if (!Row)
 		{
-			return A->GetConfig()->Priority > B->GetConfig()->Priority; 
-		});
-		return true;
+			continue;
+		}
+		if (UMaterialInstance* LoadedMaterial = Row->Material.Get())
+		{
+			OnPostProcessMaterialLoaded(EffectID, *Row, LoadedMaterial);
+			continue;
+		}
+		int32& RetryCount = LoadRetryCounts.FindOrAdd(EffectID);
+		INC_DWORD_STAT(STAT_LiquidLoadRetries);
+		if (++RetryCount <= MaxLoadRetryCount)
+		{
+			UE_LOG(LogTemp, Warning,
+				TEXT("[PostProcessCallSubsystem] Retry %d / %d : %s"),
+				RetryCount, MaxLoadRetryCount, *EffectID.ToString());
+			RetryEffectIDs.Add(EffectID);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error,
+			   TEXT("[UPostProcessCallSubsystem] Failed to load PostProcess Material for %s"),
+			   *EffectID.ToString());
+			LIQUID_TRACE_EVENT("LoadFailed", EffectID);
+			LoadingEffectIDs.Remove(EffectID);
+			const int32 NumDropped = PendingPlays.RemoveAll([&EffectID](const FPendingTransientPostProcessPlay& Play)
+				{
+					return Play.EffectID == EffectID;
+				});
+			if (NumDropped > 0)
+			{
+				UE_LOG(LogTemp, Error,
+					TEXT("[UPostProcessCallSubsystem] Dropped %d pending PostProcess call(s) for %s"), NumDropped, *EffectID.ToString());
+				LIQUID_TRACE_EVENT("Drop", EffectID);
+			}
+		}
 	}
-	return false;
+	if (!RetryEffectIDs.IsEmpty())
+	{
+		FPostProcessMaterialLoadBatch& RetryBatch = PendingLoadBatches.AddDefaulted_GetRef();
+		RetryBatch.Priority = Batch.Priority;
+		RetryBatch.EffectIDs = MoveTemp(RetryEffectIDs);
+	}
+	PumpMaterialLoadBatches();
 }
 
-bool UPostProcessCallSubsystem::BeginTransientPostProcess(const FName& EffectID, const FTransientPostProcessConfig* Config,
-	const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction)
+/**
+ * @brief マテリアルのロード完了処理。ランタイムキャッシュ・MID プールを準備し、ロード待ちの再生要求を開始する。
+ */
+void UPostProcessCallSubsystem::OnPostProcessMaterialLoaded(const FName& EffectID, const FTransientPostProcessConfig& Config, UMaterialInstance* LoadedMaterial)
 {
-	UMaterialInstance* LoadedMat = GetLoadedMaterial(EffectID);
-	if (!LoadedMat)
+	LoadingEffectIDs.Remove(EffectID);
+	CachedMaterials.Add(EffectID, LoadedMaterial);
+	BuildRowCache(EffectID, Config, LoadedMaterial);
+	WarmupMaterialPool(EffectID, Config, LoadedMaterial);
+	BuildEffectBundle(EffectID, Config, LoadedMaterial);
+	if (const UWorld* World = GetWorld())
 	{
-		UE_LOG(LogTemp, Error,
-			TEXT("[UPostProcessCallSubsystem::BeginTransientPostProcess] Material for %s is not loaded yet. PostProcess call aborted."),
-			*EffectID.ToString());
-		return false;
+		MaterialLastUsedTimes.Add(EffectID, World->GetRealTimeSeconds());
 	}
-	
-	auto InitTask =	MakeUnique<FTransientPostProcessTask>(EffectID, Config, this);
-	if (InitTask->Activate(LoadedMat, InitFunction))
+	UE_LOG(LogTemp, Log,
+	   TEXT("[UPostProcessCallSubsystem] Loaded PostProcess Material for %s"), *EffectID.ToString());
+	LIQUID_TRACE_EVENT("Load", EffectID);
+
+	TArray<FPendingTransientPostProcessPlay, TInlineAllocator<4>> ReadyPlays;
+	for (int32 Index = PendingPlays.Num() - 1; Index >= 0; --Index)
 	{
-		TransientTasks.Emplace(MoveTemp(InitTask));
-		//memo: 各TaskのTickは降順に実行されるのでここでも降順に実行することで結果的に昇順のタスク実行になるようにする
-		TransientTasks.Sort([](const TUniquePtr<FTransientPostProcessTask>& A, const TUniquePtr<FTransientPostProcessTask>& B)
+		if (PendingPlays[Index].EffectID == EffectID)
 		{
-			return A->GetConfig()->Priority > B->GetConfig()->Priority; 
-		});
-		return true;
+			ReadyPlays.Insert(MoveTemp(PendingPlays[Index]), 0);
+			PendingPlays.RemoveAt(Index, 1, EAllowShrinking::No);
+		}
+	}
+	for (const FPendingTransientPostProcessPlay& Play : ReadyPlays)
+	{
+		if (Play.TargetCamera.IsExplicitlyNull() || Play.TargetCamera.IsValid())
+		{
+			BeginTransientPostProcess(EffectID, &Config, Play.TargetCamera);
+		}
 	}
-	return false;
 }
 
 /**
- * WorldのPostActorTickイベントで呼び出される。全てのタスクを更新。
- * 終了済みのタスクは削除。
- *
- * @param InWorld World参照
- * @param InType Tickタイプ
- * @param DeltaTime 経過時間
+ * @details
+ * 再生中のタスクが参照しているマテリアルは解放しない。
+ * プール中の MID も親マテリアルを参照しているため合わせて破棄する。
  */
-void UPostProcessCallSubsystem::OnWorldPostActorTick(UWorld* InWorld, ELevelTick InType, float DeltaTime)
+void UPostProcessCallSubsystem::ReleaseUnusedMaterials(double CurrentTime)
 {
-	UWorld* CurrentWorld = GetWorld();
-	if(!CurrentWorld)
+	if (UnusedMaterialReleaseSeconds <= .0f || CurrentTime - LastReleaseCheckTime < MaterialReleaseCheckInterval)
 	{
 		return;
 	}
-	auto PlayerCameraManager = UGameplayStatics::GetPlayerCameraManager(CurrentWorld,0);
-	if (!PlayerCameraManager)
+	LastReleaseCheckTime = CurrentTime;
+	for (const FTransientPostProcessTask& Task : TransientTasks)
 	{
-		//Editorでもここに来るのでVerboseにする
-		UE_LOG(LogTemp, Verbose, TEXT("[UPostProcessCallSubsystem] CameraManager is nullptr"));
-		return;
+		MaterialLastUsedTimes.Add(Task.GetEffectID(), CurrentTime);
 	}
-	const int32 NumTask = TransientTasks.Num();
-	if (NumTask >= TransientPostProcessCapacity)
+	//note: 返却待ちの MID も親マテリアルを参照しているため使用中とみなす
+	for (const FTransientPostProcessTask& Task : RetiredTasks)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("[UPostProcessCallSubsystem] Transient Postprocess Task Size is Over Delete Index Array NumTask: %d"), NumTask);	
+		MaterialLastUsedTimes.Add(Task.GetEffectID(), CurrentTime);
 	}
-	//memo: 独立したタスク削除ループを行わないようにするために降順でTickをまわすTransientTasksは降順にソートされているため結果的に昇順に実行される
-	for (int32 Index = NumTask -1 ; Index >= 0 ; --Index)
+	for (auto It = MaterialLastUsedTimes.CreateIterator(); It; ++It)
 	{
-		//UE_LOG(LogTemp, Log, TEXT("[UPostProcessCallSubsystem] Tick %s"),*TransientTasks[Index]->GetEffectID().ToString());
-		if (TransientTasks[Index]->Tick(PlayerCameraManager, DeltaTime) == PostProcessTaskTickResult::Finish)
+		if (CurrentTime - It.Value() < UnusedMaterialReleaseSeconds)
+		{
+			continue;
+		}
+		const FName EffectID = It.Key();
+		const FTransientPostProcessConfig* Row = FindConfig(EffectID);
+		if (Row && Row->LoadPolicy == ETransientPostProcessLoadPolicy::Eager)
 		{
-			//UE_LOG(LogTemp, Log, TEXT("[UPostProcessCallSubsystem] Finish %s"),*TransientTasks[Index]->GetEffectID().ToString());
-			TransientTasks.RemoveAt(Index);
+			continue;
+		}
+		if (FPostProcessMaterialPool* Pool = MaterialPools.Find(EffectID))
+		{
+			for (UMaterialInstanceDynamic* MaterialInstance : Pool->FreeInstances)
+			{
+				EvictMaterialInstanceDynamic(MaterialInstance);
+			}
+			MaterialPools.Remove(EffectID);
 		}
+		CachedMaterials.Remove(EffectID);
+		RowCaches.Remove(EffectID);
+		EffectBundles.Remove(EffectID);
+		LoadRetryCounts.Remove(EffectID);
+		It.RemoveCurrent();
+		UpdateEffectBundleMemoryStat();
+		UE_LOG(LogTemp, Log,
+			TEXT("[UPostProcessCallSubsystem] Released unused PostProcess Material for %s"), *EffectID.ToString());
+		LIQUID_TRACE_EVENT("Unload", EffectID);
 	}
 }
 
-UMaterialInstance* UPostProcessCallSubsystem::GetLoadedMaterial(const FName& EffectID) const
+void UPostProcessCallSubsystem::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
 {
-	const TObjectPtr<UMaterialInstance>* Found = CachedMaterials.Find(EffectID);
-	return Found ? Found->Get() : nullptr;
+	UPostProcessCallSubsystem* This = CastChecked<UPostProcessCallSubsystem>(InThis);
+	for (FTransientPostProcessTask& Task : This->TransientTasks)
+	{
+		Task.AddReferencedObjects(Collector);
+	}
+	for (FTransientPostProcessTask& Task : This->RetiredTasks)
+	{
+		Task.AddReferencedObjects(Collector);
+	}
+	Super::AddReferencedObjects(InThis, Collector);
 }
 
+float UPostProcessCallSubsystem::GetEffectiveDeltaSeconds(const UWorld* InWorld)
+{
+	return (InWorld != nullptr)? InWorld->GetDeltaSeconds() : FApp::GetDeltaTime();   // World が分かるならその Δt: FApp::GetDeltaTime();
+}
+
+/**
+ * サブシステムの終了処理。デリゲート登録を解除。
+ */
+void UPostProcessCallSubsystem::Deinitialize()
+{
+	if (TableLoadingHandle.IsValid())
+	{
+		TableLoadingHandle->CancelHandle();
+		TableLoadingHandle.Reset();
+	}
+	for (auto& Pair : InFlightLoadBatches)
+	{
+		if (Pair.Value.Handle.IsValid())
+		{
+			Pair.Value.Handle->CancelHandle();
+		}
+	}
+	InFlightLoadBatches.Empty();
+	PendingLoadBatches.Empty();
+	LoadingEffectIDs.Empty();
+	PendingPlays.Empty();
+	LastTriggerTimes.Empty();
+	FWorldDelegates::OnWorldPostActorTick.Remove(PostActorTickHandle);
+	FGameModeEvents::GameModePostLoginEvent.Remove(PostLoginHandle);
+	FGameModeEvents::GameModeLogoutEvent.Remove(LogoutHandle);
+	if (UGameInstance* GameInstance = GetWorld() ? GetWorld()->GetGameInstance() : nullptr)
+	{
+		GameInstance->OnLocalPlayerAddedEvent.Remove(LocalPlayerAddedHandle);
+		GameInstance->OnLocalPlayerRemovedEvent.Remove(LocalPlayerRemovedHandle);
+	}
+	CachedCameraManagers.Empty();
+	CameraGroups.Empty();
+	ClearTransientTasks();
+	MaterialPools.Empty();
+	RowCaches.Empty();
+	EffectBundles.Empty();
+	UpdateEffectBundleMemoryStat();
+	MergedRows.Empty();
+	PostProcessTableAssets.Empty();
+}
+
+/**
+ * データテーブルから指定IDの行を取得し、該当するエフェクトを実行
+ *
+ * @param EffectID データテーブル内の行ID
+ */
+bool UPostProcessCallSubsystem::PlayTransientPostProcess(const FName& EffectID)
+{
+	return PlayTransientPostProcess(EffectID, static_cast<APlayerCameraManager*>(nullptr));
+}
+
+bool UPostProcessCallSubsystem::PlayTransientPostProcess(const FName& EffectID,
+	const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction)
+{
+	return PlayTransientPostProcess(EffectID, nullptr, InitFunction);
+}
+
+bool UPostProcessCallSubsystem::PlayTransientPostProcessForPlayer(const FName& EffectID, int32 PlayerIndex)
+{
+	APlayerCameraManager* CameraManager = GetCameraManagerForPlayer(PlayerIndex);
+	if (!CameraManager)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] CameraManager is not found PlayerIndex: %d EffectID: %s"), PlayerIndex, *EffectID.ToString());
+		return false;
+	}
+	return PlayTransientPostProcess(EffectID, CameraManager);
+}
+
+/**
+ * @param CameraManager nullptr の場合は適用先を固定せず、毎フレームその時点のプレイヤー 0 のカメラに適用する
+ */
+bool UPostProcessCallSubsystem::PlayTransientPostProcess(const FName& EffectID, APlayerCameraManager* CameraManager)
+{
+	CSV_SCOPED_TIMING_STAT(Liquid, Play);
+	CSV_EVENT(Liquid, TEXT("Play %s"), *EffectID.ToString());
+	const TWeakObjectPtr<APlayerCameraManager> TargetCamera = CameraManager;
+	if(!bTablesLoaded)
+	{
+		//note: テーブルのロード完了後に再生する
+		if (TableLoadingHandle.IsValid())
+		{
+			PendingPlays.Add({EffectID, TargetCamera});
+			return true;
+		}
+		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] PostProcessTable is not loaded"));
+		return false;
+	}
+	if(const FTransientPostProcessConfig* Row = FindConfig(EffectID))
+	{
+	
+		if (Row->Duration <= .0f)
+		{
+			UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Duration is 0 EffectID: %s "), *EffectID.ToString());
+			return false;
+		}
+		if (IsInRetriggerCooldown(EffectID, *Row))
+		{
+			return false;
+		}
+		//note: 同時実行数の上限等で破棄された再生はクールダウンの起点にしない
+		if (!BeginTransientPostProcess(EffectID, Row, TargetCamera))
+		{
+			return false;
+		}
+		RecordRetrigger(EffectID, *Row);
+		return true;
+	}
+	else
+	{
+		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Not Found ID: %s "), *EffectID.ToString());	
+	}
+	return false;
+}
+
+bool UPostProcessCallSubsystem::PlayTransientPostProcess(const FName& EffectID, APlayerCameraManager* CameraManager,
+	const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction)
+{
+	CSV_SCOPED_TIMING_STAT(Liquid, Play);
+	CSV_EVENT(Liquid, TEXT("Play %s"), *EffectID.ToString());
+	if(!bTablesLoaded)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] PostProcessTable is not loaded yet"));
+		return false;
+	}
+	if(const FTransientPostProcessConfig* Row = FindConfig(EffectID))
+	{
+		if (Row->Duration <= .0f)
+		{
+			UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Duration is 0 EffectID: %s "), *EffectID.ToString());
+			return false;
+		}
+		if (IsInRetriggerCooldown(EffectID, *Row))
+		{
+			return false;
+		}
+		if (!BeginTransientPostProcess(EffectID, Row, CameraManager, InitFunction))
+		{
+			return false;
+		}
+		RecordRetrigger(EffectID, *Row);
+		return true;
+	}
+	return false;
+}
+
+bool UPostProcessCallSubsystem::IsPlayingTransientPostProcess(const FName& EffectID, const UWorld* InWorld) const
+{
+	//note: マテリアルのロード待ちで再生開始前のものも再生中として扱う
+	if (PendingPlays.ContainsByPredicate([&EffectID](const FPendingTransientPostProcessPlay& Play){return Play.EffectID == EffectID;}))
+	{
+		return true;
+	}
+	const FTransientPostProcessTask* ExistTask = TransientTasks.FindByPredicate(
+		[&EffectID](const FTransientPostProcessTask& Task)
+		{
+			return Task.GetEffectID() == EffectID;
+		});
+	if (!ExistTask)
+	{
+		return false;
+	}
+	float Delta = GetEffectiveDeltaSeconds(InWorld);
+	return !ExistTask->IsScheduleDeleteTask(Delta);
+}
+
+/**
+ * タスクを初期化・有効化し、実行中タスクリストに追加
+ *
+ * @param EffectID DataTable上のID
+ * @param Config 実行するエフェクトの設定情報
+ */
+bool UPostProcessCallSubsystem::BeginTransientPostProcess(const FName& EffectID, const FTransientPostProcessConfig* Config,
+	const TWeakObjectPtr<APlayerCameraManager>& TargetCamera)
+{
+	UMaterialInstance* LoadedMat = GetLoadedMaterial(EffectID);
+	if (!LoadedMat)
+	{
+		//note: ロード中(またはロード可能)な場合はロード完了後に再生する
+		if (PendingPlays.Num() >= FMath::Max(MaxTransientTasks, 1))
+		{
+			UE_LOG(LogTemp, Verbose, TEXT("[UPostProcessCallSubsystem] Too many pending PostProcess calls. Rejected %s"), *EffectID.ToString());
+			LIQUID_TRACE_EVENT("Drop", EffectID);
+			return false;
+		}
+		if (RequestMaterialLoad(EffectID, *Config))
+		{
+			PendingPlays.Add({EffectID, TargetCamera});
+			LIQUID_TRACE_EVENT("PlayPending", EffectID);
+			return true;
+		}
+		UE_LOG(LogTemp, Error,
+			TEXT("[UPostProcessCallSubsystem::BeginTransientPostProcess] Material for %s is not loaded yet. PostProcess call aborted."),
+			*EffectID.ToString());
+		return false;
+	}
+	int32 RestartIndex = INDEX_NONE;
+	if (!MakeRoomForTransientTask(EffectID, *Config, TargetCamera, RestartIndex))
+	{
+		return false;
+	}
+	if (const UWorld* World = GetWorld())
+	{
+		MaterialLastUsedTimes.Add(EffectID, World->GetRealTimeSeconds());
+	}
+	RequestEffectTextureMips(EffectID, *Config);
+	if (RestartIndex != INDEX_NONE)
+	{
+		TransientTasks[RestartIndex].Restart();
+		LIQUID_TRACE_EVENT("Restart", EffectID);
+		return true;
+	}
+	FTransientPostProcessTask InitTask(EffectID, Config, this, TargetCamera, FindRowCache(EffectID));
+	if (InitTask.Activate(LoadedMat))
+	{
+		InsertTransientTask(MoveTemp(InitTask));
+		LIQUID_TRACE_EVENT("Play", EffectID);
+		return true;
+	}
+	return false;
+}
+
+bool UPostProcessCallSubsystem::BeginTransientPostProcess(const FName& EffectID, const FTransientPostProcessConfig* Config,
+	const TWeakObjectPtr<APlayerCameraManager>& TargetCamera, const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction)
+{
+	UMaterialInstance* LoadedMat = GetLoadedMaterial(EffectID);
+	if (!LoadedMat)
+	{
+		//note: InitFunction は呼び出し元のスコープでしか有効でないため再生を遅延できない。ロードのみ開始する
+		RequestMaterialLoad(EffectID, *Config);
+		UE_LOG(LogTemp, Error,
+			TEXT("[UPostProcessCallSubsystem::BeginTransientPostProcess] Material for %s is not loaded yet. PostProcess call aborted."),
+			*EffectID.ToString());
+		return false;
+	}
+	int32 RestartIndex = INDEX_NONE;
+	if (!MakeRoomForTransientTask(EffectID, *Config, TargetCamera, RestartIndex))
+	{
+		return false;
+	}
+	if (const UWorld* World = GetWorld())
+	{
+		MaterialLastUsedTimes.Add(EffectID, World->GetRealTimeSeconds());
+	}
+	RequestEffectTextureMips(EffectID, *Config);
+	if (RestartIndex != INDEX_NONE)
+	{
+		TransientTasks[RestartIndex].Restart(InitFunction);
+		LIQUID_TRACE_EVENT("Restart", EffectID);
+		return true;
+	}
+	
+	FTransientPostProcessTask InitTask(EffectID, Config, this, TargetCamera, FindRowCache(EffectID));
+	if (InitTask.Activate(LoadedMat, InitFunction))
+	{
+		InsertTransientTask(MoveTemp(InitTask));
+		LIQUID_TRACE_EVENT("Play", EffectID);
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @details
+ * TransientTasks は常に Priority の昇順に並んでいるため、二分探索で同一 Priority の末尾へ挿入する。
+ * 全体の再ソートを行わず、同一 Priority 間の順序(追加順)も保たれる。
+ */
+void UPostProcessCallSubsystem::InsertTransientTask(FTransientPostProcessTask&& Task)
+{
+	const int32 InsertIndex = Algo::UpperBoundBy(TransientTasks, Task.GetPriority(),
+		[](const FTransientPostProcessTask& Element)
+		{
+			return Element.GetPriority();
+		});
+	TransientTasks.Insert(MoveTemp(Task), InsertIndex);
+}
+
+void UPostProcessCallSubsystem::ClearTransientTasks()
+{
+	ReleaseRetiredTasks();
+	for (FTransientPostProcessTask& Task : TransientTasks)
+	{
+		Task.Cleanup();
+	}
+	TransientTasks.Reset();
+}
+
+void UPostProcessCallSubsystem::RetireTransientTask(FTransientPostProcessTask&& Task)
+{
+	RetiredTasks.Add(MoveTemp(Task));
+}
+
+void UPostProcessCallSubsystem::ReleaseRetiredTasks()
+{
+	for (FTransientPostProcessTask& Task : RetiredTasks)
+	{
+		Task.Cleanup();
+	}
+	RetiredTasks.Reset();
+}
+
+/**
+ * @details
+ * - 行の MaxConcurrentInstances に達している場合は同じ EffectID のタスクのみを終了・再始動の対象にする。
+ * - MaxTransientTasks に達している場合は全タスクを対象にする。
+ * - RestartSameEffect は対象に関わらず同じ EffectID・同じ適用先カメラのうち最も古いタスクを再始動する。
+ */
+bool UPostProcessCallSubsystem::MakeRoomForTransientTask(const FName& EffectID, const FTransientPostProcessConfig& Config,
+	const TWeakObjectPtr<APlayerCameraManager>& TargetCamera, int32& OutRestartIndex)
+{
+	OutRestartIndex = INDEX_NONE;
+	bool bEffectLimit = false;
+	if (Config.MaxConcurrentInstances > 0)
+	{
+		int32 NumInstances = 0;
+		for (const FTransientPostProcessTask& Task : TransientTasks)
+		{
+			NumInstances += Task.GetEffectID() == EffectID ? 1 : 0;
+		}
+		bEffectLimit = NumInstances >= Config.MaxConcurrentInstances;
+	}
+	const bool bGlobalLimit = TransientTasks.Num() >= FMath::Max(MaxTransientTasks, 1);
+	if (!bEffectLimit && !bGlobalLimit)
+	{
+		return true;
+	}
+
+	const FName* EffectIDFilter = bEffectLimit ? &EffectID : nullptr;
+	int32 EvictIndex = INDEX_NONE;
+	switch (OverflowPolicy)
+	{
+	case ETransientPostProcessOverflowPolicy::EvictLowestPriority:
+		EvictIndex = FindLowestPriorityTask(EffectIDFilter);
+		if (EvictIndex != INDEX_NONE && TransientTasks[EvictIndex].GetPriority() > Config.Priority)
+		{
+			//note: 新しい要求の方が Priority が低い場合は新しい要求を破棄する
+			EvictIndex = INDEX_NONE;
+		}
+		break;
+	case ETransientPostProcessOverflowPolicy::EvictOldest:
+		EvictIndex = FindOldestTask(EffectIDFilter);
+		break;
+	case ETransientPostProcessOverflowPolicy::RestartSameEffect:
+		{
+			float OldestElapsedTime = -1.0f;
+			for (int32 Index = 0; Index < TransientTasks.Num(); ++Index)
+			{
+				const FTransientPostProcessTask& Task = TransientTasks[Index];
+				if (Task.GetEffectID() == EffectID && Task.GetTargetCamera() == TargetCamera && Task.GetElapsedTime() > OldestElapsedTime)
+				{
+					OutRestartIndex = Index;
+					OldestElapsedTime = Task.GetElapsedTime();
+				}
+			}
+			if (OutRestartIndex != INDEX_NONE)
+			{
+				return true;
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	if (EvictIndex == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Verbose,
+			TEXT("[UPostProcessCallSubsystem] Transient PostProcess limit reached. Rejected %s (NumTask: %d)"),
+			*EffectID.ToString(), TransientTasks.Num());
+		LIQUID_TRACE_EVENT("Drop", EffectID);
+		return false;
+	}
+	UE_LOG(LogTemp, Verbose,
+		TEXT("[UPostProcessCallSubsystem] Transient PostProcess limit reached. Evicted %s for %s"),
+		*TransientTasks[EvictIndex].GetEffectID().ToString(), *EffectID.ToString());
+	LIQUID_TRACE_EVENT("Evict", TransientTasks[EvictIndex].GetEffectID());
+	//note: 同じフレームで既に Blendable として追加されている可能性があるため、MID の返却は次の更新まで遅らせる
+	RetireTransientTask(MoveTemp(TransientTasks[EvictIndex]));
+	TransientTasks.RemoveAt(EvictIndex, 1, EAllowShrinking::No);
+	return true;
+}
+
+int32 UPostProcessCallSubsystem::FindLowestPriorityTask(const FName* EffectIDFilter) const
+{
+	//note: TransientTasks は Priority の昇順(同一 Priority は追加順)に並んでいるため最初に見つかったものが対象
+	return TransientTasks.IndexOfByPredicate([EffectIDFilter](const FTransientPostProcessTask& Task)
+		{
+			return !EffectIDFilter || Task.GetEffectID() == *EffectIDFilter;
+		});
+}
 
+int32 UPostProcessCallSubsystem::FindOldestTask(const FName* EffectIDFilter) const
+{
+	int32 OldestIndex = INDEX_NONE;
+	float OldestElapsedTime = -1.0f;
+	for (int32 Index = 0; Index < TransientTasks.Num(); ++Index)
+	{
+		const FTransientPostProcessTask& Task = TransientTasks[Index];
+		if (EffectIDFilter && Task.GetEffectID() != *EffectIDFilter)
+		{
+			continue;
+		}
+		if (Task.GetElapsedTime() > OldestElapsedTime)
+		{
+			OldestIndex = Index;
+			OldestElapsedTime = Task.GetElapsedTime();
+		}
+	}
+	return OldestIndex;
+}
+
+bool UPostProcessCallSubsystem::IsInRetriggerCooldown(const FName& EffectID, const FTransientPostProcessConfig& Config) const
+{
+	const UWorld* World = GetWorld();
+	if (Config.RetriggerCooldown <= .0f || !World)
+	{
+		return false;
+	}
+	const double* LastTriggerTime = LastTriggerTimes.Find(EffectID);
+	if (!LastTriggerTime || World->GetTimeSeconds() - *LastTriggerTime >= Config.RetriggerCooldown)
+	{
+		return false;
+	}
+	UE_LOG(LogTemp, Verbose, TEXT("[UPostProcessCallSubsystem] %s is in retrigger cooldown"), *EffectID.ToString());
+	LIQUID_TRACE_EVENT("Drop", EffectID);
+	return true;
+}
+
+void UPostProcessCallSubsystem::RecordRetrigger(const FName& EffectID, const FTransientPostProcessConfig& Config)
+{
+	const UWorld* World = GetWorld();
+	if (Config.RetriggerCooldown <= .0f || !World)
+	{
+		return;
+	}
+	LastTriggerTimes.Add(EffectID, World->GetTimeSeconds());
+}
+
+/**
+ * WorldのPostActorTickイベントで呼び出される。全てのタスクを更新。
+ * タスクの Blendable を適用先のカメラ毎に Priority 順で FPostProcessSettings へまとめ、カメラ毎に 1 回だけ適用する。
+ * 終了済みのタスクは削除。
+ *
+ * @param InWorld World参照
+ * @param InType Tickタイプ
+ * @param DeltaTime 経過時間
+ */
+void UPostProcessCallSubsystem::OnWorldPostActorTick(UWorld* InWorld, ELevelTick InType, float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LiquidPostActorTick);
+	CSV_SCOPED_TIMING_STAT(Liquid, PostActorTick);
+	UWorld* CurrentWorld = GetWorld();
+	if(!CurrentWorld)
+	{
+		return;
+	}
+	ReleaseUnusedMaterials(CurrentWorld->GetRealTimeSeconds());
+	TickTransientTasks(DeltaTime);
+}
+
+/**
+ * @details
+ * TransientTasks は Priority の昇順に並んでいるため先頭から更新すればそのまま各カメラでの適用順になる。
+ * 終了したタスクは後続の要素を詰めながら 1 パスで取り除く(順序は保たれ、要素毎のシフトは発生しない)。
+ * 適用先のカメラが破棄されたタスクは終了する。
+ * 適用先を固定しないタスクはプレイヤー 0 のカメラが見つかるまで更新しない。
+ */
+void UPostProcessCallSubsystem::TickTransientTasks(float DeltaTime)
+{
+	//note: 前フレームで終了したタスクの MID は描画済みのため、ここでプールへ返却する
+	ReleaseRetiredTasks();
+	//note: 確保済みのメモリを使い回すため Reset で要素のみ破棄する
+	for (FTransientPostProcessCameraGroup& Group : CameraGroups)
+	{
+		Group.Settings.WeightedBlendables.Array.Reset();
+	}
+	APlayerCameraManager* PrimaryCamera = GetCameraManagerForPlayer(0);
+	//note: 同じカメラのタスクが続くことが多いため直前のグループを使い回して検索を省略する
+	const APlayerCameraManager* LastCamera = nullptr;
+	int32 LastGroupIndex = INDEX_NONE;
+	const int32 NumTask = TransientTasks.Num();
+	//note: このフレームで終了するタスクも含めた同時実行数
+	CSV_CUSTOM_STAT(Liquid, MaxConcurrentTasks, NumTask, ECsvCustomStatOp::Max);
+	int32 WriteIndex = 0;
+	for (int32 ReadIndex = 0; ReadIndex < NumTask; ++ReadIndex)
+	{
+		FTransientPostProcessTask& Task = TransientTasks[ReadIndex];
+		const TWeakObjectPtr<APlayerCameraManager>& TargetCamera = Task.GetTargetCamera();
+		APlayerCameraManager* Camera = TargetCamera.IsExplicitlyNull() ? PrimaryCamera : TargetCamera.Get();
+		if (!Camera && !TargetCamera.IsExplicitlyNull())
+		{
+			LIQUID_TRACE_EVENT("Drop", Task.GetEffectID());
+			Task.Cleanup();
+			continue;
+		}
+		//note: 適用先を固定しないタスクはプレイヤー 0 のカメラが無い間(マップ遷移中など)は経過時間を進めずに保持する
+		if (!Camera)
+		{
+			if (WriteIndex != ReadIndex)
+			{
+				TransientTasks[WriteIndex] = MoveTemp(Task);
+			}
+			++WriteIndex;
+			continue;
+		}
+		if (LastGroupIndex == INDEX_NONE || Camera != LastCamera)
+		{
+			LastGroupIndex = FindOrAddCameraGroup(Camera);
+			LastCamera = Camera;
+		}
+		if (Task.Tick(CameraGroups[LastGroupIndex].Settings.WeightedBlendables, DeltaTime) == PostProcessTaskTickResult::Finish)
+		{
+			LIQUID_TRACE_EVENT("Finish", Task.GetEffectID());
+			RetireTransientTask(MoveTemp(Task));
+			continue;
+		}
+		if (WriteIndex != ReadIndex)
+		{
+			TransientTasks[WriteIndex] = MoveTemp(Task);
+		}
+		++WriteIndex;
+	}
+	TransientTasks.SetNum(WriteIndex, EAllowShrinking::No);
+	SET_DWORD_STAT(STAT_LiquidActiveTasks, TransientTasks.Num());
+	SET_DWORD_STAT(STAT_LiquidCachedMaterials, CachedMaterials.Num());
+	CSV_CUSTOM_STAT(Liquid, ActiveTasks, TransientTasks.Num(), ECsvCustomStatOp::Set);
+	for (FTransientPostProcessCameraGroup& Group : CameraGroups)
+	{
+		APlayerCameraManager* CameraManager = Group.CameraManager.Get();
+		if (CameraManager && !Group.Settings.WeightedBlendables.Array.IsEmpty())
+		{
+			CameraManager->AddCachedPPBlend(Group.Settings, 1.0f, VTBlendOrder_Override);
+		}
+	}
+}
+
+/**
+ * @details
+ * 破棄されたカメラのグループは確保済みの FPostProcessSettings ごと別のカメラで再利用する。
+ */
+int32 UPostProcessCallSubsystem::FindOrAddCameraGroup(APlayerCameraManager* CameraManager)
+{
+	int32 ReusableIndex = INDEX_NONE;
+	for (int32 Index = 0; Index < CameraGroups.Num(); ++Index)
+	{
+		const TWeakObjectPtr<APlayerCameraManager>& GroupCamera = CameraGroups[Index].CameraManager;
+		if (GroupCamera.Get() == CameraManager && !GroupCamera.IsStale())
+		{
+			return Index;
+		}
+		if (ReusableIndex == INDEX_NONE && GroupCamera.IsStale())
+		{
+			ReusableIndex = Index;
+		}
+	}
+	if (ReusableIndex == INDEX_NONE)
+	{
+		ReusableIndex = CameraGroups.AddDefaulted();
+	}
+	CameraGroups[ReusableIndex].CameraManager = CameraManager;
+	return ReusableIndex;
+}
+
+APlayerCameraManager* UPostProcessCallSubsystem::GetCameraManagerForPlayer(int32 PlayerIndex)
+{
+	//note: キャッシュ済みのカメラが破棄された場合(シームレストラベル等)も再構築する
+	if (bCameraManagersDirty || (CachedCameraManagers.IsValidIndex(PlayerIndex) && CachedCameraManagers[PlayerIndex].IsStale()))
+	{
+		RebuildCameraManagerCache();
+	}
+	return CachedCameraManagers.IsValidIndex(PlayerIndex) ? CachedCameraManagers[PlayerIndex].Get() : nullptr;
+}
+
+/**
+ * @details
+ * ローカルプレイヤーの並び順でカメラを収集する。
+ * PlayerController(カメラ)の生成はローカルプレイヤーの追加より遅れるため、全員分揃うまでは次回も再構築する。
+ */
+void UPostProcessCallSubsystem::RebuildCameraManagerCache()
+{
+	CachedCameraManagers.Reset();
+	bCameraManagersDirty = false;
+	UWorld* World = GetWorld();
+	const UGameInstance* GameInstance = World ? World->GetGameInstance() : nullptr;
+	if (!GameInstance)
+	{
+		return;
+	}
+	for (const ULocalPlayer* LocalPlayer : GameInstance->GetLocalPlayers())
+	{
+		const APlayerController* PlayerController = LocalPlayer ? LocalPlayer->GetPlayerController(World) : nullptr;
+		APlayerCameraManager* CameraManager = PlayerController ? PlayerController->PlayerCameraManager.Get() : nullptr;
+		bCameraManagersDirty |= CameraManager == nullptr;
+		CachedCameraManagers.Emplace(CameraManager);
+	}
+}
+
+void UPostProcessCallSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	if (UGameInstance* GameInstance = InWorld.GetGameInstance())
+	{
+		LocalPlayerAddedHandle = GameInstance->OnLocalPlayerAddedEvent.AddUObject(
+			this, &UPostProcessCallSubsystem::OnLocalPlayersChanged);
+		LocalPlayerRemovedHandle = GameInstance->OnLocalPlayerRemovedEvent.AddUObject(
+			this, &UPostProcessCallSubsystem::OnLocalPlayersChanged);
+	}
+	bCameraManagersDirty = true;
+}
+
+void UPostProcessCallSubsystem::OnLocalPlayersChanged(ULocalPlayer* LocalPlayer)
+{
+	bCameraManagersDirty = true;
+}
+
+void UPostProcessCallSubsystem::OnGameModePostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer)
+{
+	if (GameMode && GameMode->GetWorld() == GetWorld())
+	{
+		bCameraManagersDirty = true;
+	}
+}
+
+void UPostProcessCallSubsystem::OnGameModeLogout(AGameModeBase* GameMode, AController* Exiting)
+{
+	if (GameMode && GameMode->GetWorld() == GetWorld())
+	{
+		bCameraManagersDirty = true;
+	}
+}
+
+UMaterialInstance* UPostProcessCallSubsystem::GetLoadedMaterial(const FName& EffectID) const
+{
+	const TObjectPtr<UMaterialInstance>* Found = CachedMaterials.Find(EffectID);
+	return Found ? Found->Get() : nullptr;
+}
+
+
+
+/**
+ * @details
+ * - プール先頭から親マテリアルが一致する MID を取り出して返す(ヒット)。
+ * - 親マテリアルが一致しない MID はテーブル更新等で不要になったものなので破棄する。
+ * - 再利用できる MID が無ければ新規生成する(ミス)。
+ */
+UMaterialInstanceDynamic* UPostProcessCallSubsystem::AcquireMaterialInstanceDynamic(const FName& EffectID, UMaterialInstance* ParentMaterial)
+{
+	SCOPE_CYCLE_COUNTER(STAT_LiquidAcquireMID);
+	if (FPostProcessMaterialPool* Pool = MaterialPools.Find(EffectID))
+	{
+		while (!Pool->FreeInstances.IsEmpty())
+		{
+			UMaterialInstanceDynamic* Pooled = Pool->FreeInstances.Pop(EAllowShrinking::No);
+			if (IsValid(Pooled) && Pooled->Parent == ParentMaterial)
+			{
+				++MaterialPoolStats.Hits;
+				return Pooled;
+			}
+			EvictMaterialInstanceDynamic(Pooled);
+		}
+	}
+	++MaterialPoolStats.Misses;
+	return UMaterialInstanceDynamic::Create(ParentMaterial, this);
+}
+
+void UPostProcessCallSubsystem::ReleaseMaterialInstanceDynamic(const FName& EffectID, const FTransientPostProcessConfig& Config, UMaterialInstanceDynamic* MaterialInstance)
+{
+	if (!IsValid(MaterialInstance))
+	{
+		return;
+	}
+	FPostProcessMaterialPool& Pool = MaterialPools.FindOrAdd(EffectID);
+	if (Pool.FreeInstances.Num() >= Config.PoolCapacity)
+	{
+		EvictMaterialInstanceDynamic(MaterialInstance);
+		return;
+	}
+	//note: 再生時の InitFunction やカーブで上書きされた値を親マテリアルの値へ戻しておく
+	MaterialInstance->ClearParameterValues();
+	Pool.FreeInstances.Add(MaterialInstance);
+}
+
+void UPostProcessCallSubsystem::WarmupMaterialPool(const FName& EffectID, const FTransientPostProcessConfig& Config, UMaterialInstance* ParentMaterial)
+{
+	const int32 WarmupCount = FMath::Min(Config.PoolWarmupCount, Config.PoolCapacity);
+	if (WarmupCount <= 0)
+	{
+		return;
+	}
+	FPostProcessMaterialPool& Pool = MaterialPools.FindOrAdd(EffectID);
+	Pool.FreeInstances.Reserve(Config.PoolCapacity);
+	while (Pool.FreeInstances.Num() < WarmupCount)
+	{
+		UMaterialInstanceDynamic* MaterialInstance = UMaterialInstanceDynamic::Create(ParentMaterial, this);
+		if (!MaterialInstance)
+		{
+			UE_LOG(LogTemp, Error, TEXT("[UPostProcessCallSubsystem] Failed Warmup Material Instance Dynamic: %s"), *EffectID.ToString());
+			return;
+		}
+		Pool.FreeInstances.Add(MaterialInstance);
+	}
+}
+
+void UPostProcessCallSubsystem::EvictMaterialInstanceDynamic(UMaterialInstanceDynamic* MaterialInstance)
+{
+	++MaterialPoolStats.Evictions;
+	// MID を即座に GC 対象へ
+	if (IsValid(MaterialInstance))
+	{
+		MaterialInstance->MarkAsGarbage();
+	}
+}
+
+/**
+ * @details
+ * - ControlParameters のパラメータがマテリアルに存在するかを検証し、存在しないものはここで一度だけ報告する。
+ * - bUseBakedCurves が有効な行は ControlParameters / NormalizedWeightCurve を BakedCurveResolution でベイクする。
+ * - 非 Shipping ビルドではベイク結果と元カーブの誤差を検証し、許容値を超えた場合は警告を出す。
+ */
+void UPostProcessCallSubsystem::BuildRowCache(const FName& EffectID, const FTransientPostProcessConfig& Config, const UMaterialInstance* Material)
+{
+	TSharedRef<FTransientPostProcessRowCache> Cache = MakeShared<FTransientPostProcessRowCache>();
+	Cache->ValidParameterMask.Init(true, Config.ControlParameters.Num());
+	for (int32 Index = 0; Index < Config.ControlParameters.Num(); ++Index)
+	{
+		const FName& ParameterName = Config.ControlParameters[Index].MaterialParameterName;
+		if (ParameterName == NAME_None)
+		{
+			continue;
+		}
+		float DefaultValue = .0f;
+		if (!Material->GetScalarParameterValue(FHashedMaterialParameterInfo(ParameterName), DefaultValue))
+		{
+			Cache->ValidParameterMask[Index] = false;
+			UE_LOG(LogTemp, Warning,
+				TEXT("[UPostProcessCallSubsystem] Scalar parameter %s is not found in %s EffectID: %s. The parameter is ignored."),
+				*ParameterName.ToString(), *Material->GetName(), *EffectID.ToString());
+		}
+	}
+	if (Config.bUseBakedCurves)
+	{
+		Cache->ParameterCurves.SetNum(Config.ControlParameters.Num());
+		for (int32 Index = 0; Index < Config.ControlParameters.Num(); ++Index)
+		{
+			const FPostProcessControlParams& Parameters = Config.ControlParameters[Index];
+			if (Parameters.MaterialParameterName != NAME_None)
+			{
+				Cache->ParameterCurves[Index].Bake(Parameters.NormalizedFloatCurve, Config.BakedCurveResolution);
+			}
+		}
+		Cache->WeightCurve.Bake(Config.NormalizedWeightCurve, Config.BakedCurveResolution);
+		Cache->bBaked = true;
+
+#if !UE_BUILD_SHIPPING
+		auto Validate = [&EffectID, &Config](const FPostProcessCurveTable& Table, const UCurveFloat* Curve)
+		{
+			if (!Curve || !Table.IsBaked())
+			{
+				return;
+			}
+			const float Tolerance = FPostProcessCurveTable::GetErrorTolerance(Curve);
+			const float Error = Table.MeasureMaxError(Curve, Config.BakedCurveResolution * FPostProcessCurveTable::ErrorStepsPerSample);
+			if (Error > Tolerance)
+			{
+				UE_LOG(LogTemp, Warning,
+					TEXT("[UPostProcessCallSubsystem] Baked curve %s exceeds tolerance (Error: %f Tolerance: %f) EffectID: %s. Increase BakedCurveResolution."),
+					*Curve->GetName(), Error, Tolerance, *EffectID.ToString());
+			}
+		};
+		for (int32 Index = 0; Index < Config.ControlParameters.Num(); ++Index)
+		{
+			Validate(Cache->ParameterCurves[Index], Config.ControlParameters[Index].NormalizedFloatCurve);
+		}
+		Validate(Cache->WeightCurve, Config.NormalizedWeightCurve);
+#endif
+	}
+	RowCaches.Add(EffectID, Cache);
+}
+
+/**
+ * @details
+ * - マテリアルが参照するテクスチャ(全品質レベル)と、行が参照するカーブを依存アセットとして収集する。
+ * - カーブはテーブルからのハード参照のため既に常駐しているが、メモリ使用量の集計には含める。
+ * - テクスチャは CPU 側は常駐していても GPU 側の Mip は初回描画時にストリーミングされるため、
+ *   bPreloadTextureMips の行は TextureMipPreloadSeconds の間、全Mipを常駐させておく。
+ */
+void UPostProcessCallSubsystem::BuildEffectBundle(const FName& EffectID, const FTransientPostProcessConfig& Config, UMaterialInstance* Material)
+{
+	FLiquidEffectBundle& Bundle = EffectBundles.Add(EffectID);
+	Bundle.AddMaterial(Material);
+	Bundle.AddCurve(Config.NormalizedWeightCurve);
+	for (const FPostProcessControlParams& Param : Config.ControlParameters)
+	{
+		Bundle.AddCurve(Param.NormalizedFloatCurve);
+	}
+	if (Config.bPreloadTextureMips)
+	{
+		Bundle.RequestTextureMips(TextureMipPreloadSeconds);
+	}
+	UpdateEffectBundleMemoryStat();
+	UE_LOG(LogTemp, Log,
+		TEXT("[UPostProcessCallSubsystem] Effect Bundle %s: %s"), *EffectID.ToString(), *Bundle.ToString());
+}
+
+void UPostProcessCallSubsystem::RequestEffectTextureMips(const FName& EffectID, const FTransientPostProcessConfig& Config) const
+{
+	if (!Config.bPreloadTextureMips)
+	{
+		return;
+	}
+	if (const FLiquidEffectBundle* Bundle = EffectBundles.Find(EffectID))
+	{
+		Bundle->RequestTextureMips(Config.Duration);
+	}
+}
+
+void UPostProcessCallSubsystem::UpdateEffectBundleMemoryStat() const
+{
+#if STATS
+	int64 TotalBytes = 0;
+	for (const TPair<FName, FLiquidEffectBundle>& Pair : EffectBundles)
+	{
+		TotalBytes += Pair.Value.GetTotalBytes();
+	}
+	SET_MEMORY_STAT(STAT_LiquidEffectBundleMemory, TotalBytes);
+#endif
+}
+
+int64 UPostProcessCallSubsystem::GetEffectBundleFootprintBytes(FName EffectID) const
+{
+	const FLiquidEffectBundle* Bundle = EffectBundles.Find(EffectID);
+	return Bundle ? Bundle->GetTotalBytes() : 0;
+}
+
+TSharedPtr<const FTransientPostProcessRowCache> UPostProcessCallSubsystem::FindRowCache(const FName& EffectID) const
+{
+	const TSharedPtr<const FTransientPostProcessRowCache>* Found = RowCaches.Find(EffectID);
+	return Found ? *Found : nullptr;
+}
@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "RuntimeAssetCache.h"
+#include "Engine/AssetManager.h"
+#include "HAL/IConsoleManager.h"
+#include "LiquidStats.h"
+
+static TAutoConsoleVariable<float> CVarRuntimeAssetCacheGracePeriod(
+	TEXT("liquid.AssetCache.GracePeriod"), 10.0f,
+	TEXT("Seconds an unreferenced shared asset stays resident before it is released."));
+static TAutoConsoleVariable<int32> CVarRuntimeAssetCacheMaxUnreferenced(
+	TEXT("liquid.AssetCache.MaxUnreferenced"), 64,
+	TEXT("Max number of unreferenced shared assets kept during the grace period. Oldest ones are released first."));
+
+FRuntimeAssetCache& FRuntimeAssetCache::Get()
+{
+	static FRuntimeAssetCache Instance;
+	return Instance;
+}
+
+uint64 FRuntimeAssetCache::Acquire(const FSoftObjectPath& Path, FOnAssetLoaded Callback, int32 Priority)
+{
+	check(IsInGameThread());
+	if (Path.IsNull())
+	{
+		return 0;
+	}
+
+	FEntry* Entry = Entries.Find(Path);
+	if (Entry == nullptr)
+	{
+		Entry = &Entries.Add(Path);
+		SET_DWORD_STAT(STAT_LiquidSharedAssets, Entries.Num());
+	}
+	if (Entry->RefCount++ == 0)
+	{
+		UnreferencedLRU.RemoveSingle(Path);
+		UpdateTicker();
+	}
+
+	//ロード済み(猶予中を含む) ※ロードに失敗したエントリは Asset が無効なので再ロードする
+	if (!Entry->bLoading && Entry->Asset.IsValid())
+	{
+		if (Callback)
+		{
+			Callback(Entry->Asset.Get());
+		}
+		return 0;
+	}
+
+	FStreamableManager& Manager = UAssetManager::GetStreamableManager();
+	//既にメモリ上にある場合はロードを待たずに返す。(Handle は参照を保持するためだけに取得する)
+	if (!Entry->bLoading)
+	{
+		if (UObject* Resident = Path.ResolveObject())
+		{
+			Entry->Asset = Resident;
+			Entry->Handle = Manager.RequestAsyncLoad(Path, FStreamableDelegate(), Priority, true);
+			if (Callback)
+			{
+				Callback(Resident);
+			}
+			return 0;
+		}
+	}
+
+	uint64 CallbackID = 0;
+	if (Callback)
+	{
+		CallbackID = NextCallbackID++;
+		Entry->Callbacks.Emplace(CallbackID, MoveTemp(Callback));
+	}
+	//ロード中の要求はまとめる
+	if (Entry->bLoading)
+	{
+		return CallbackID;
+	}
+
+	Entry->bLoading = true;
+	TSharedPtr<FStreamableHandle> Handle = Manager.RequestAsyncLoad(
+		Path,
+		FStreamableDelegate::CreateRaw(this, &FRuntimeAssetCache::OnLoadCompleted, Path),
+		Priority,
+		true);
+	//ロード済みのアセットだった場合は RequestAsyncLoad 内でコールバックが呼ばれていて、Entry は再確保されている可能性がある
+	if (FEntry* Current = Entries.Find(Path))
+	{
+		Current->Handle = Handle;
+		if (!Handle.IsValid())
+		{
+			OnLoadCompleted(Path);
+		}
+	}
+	return CallbackID;
+}
+
+void FRuntimeAssetCache::Release(const FSoftObjectPath& Path)
+{
+	check(IsInGameThread());
+	FEntry* Entry = Entries.Find(Path);
+	if (Entry == nullptr || Entry->RefCount <= 0)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("[FRuntimeAssetCache] Release called without Acquire: %s"), *Path.ToString());
+		return;
+	}
+	if (--Entry->RefCount > 0)
+	{
+		return;
+	}
+	Entry->ReleasedTime = FPlatformTime::Seconds();
+	UnreferencedLRU.Add(Path);
+	const int32 MaxUnreferenced = FMath::Max(CVarRuntimeAssetCacheMaxUnreferenced.GetValueOnGameThread(), 0);
+	while (UnreferencedLRU.Num() > MaxUnreferenced)
+	{
+		Evict(UnreferencedLRU[0]);
+	}
+	UpdateTicker();
+}
+
+void FRuntimeAssetCache::CancelCallback(const FSoftObjectPath& Path, uint64 CallbackID)
+{
+	if (CallbackID == 0)
+	{
+		return;
+	}
+	if (FEntry* Entry = Entries.Find(Path))
+	{
+		Entry->Callbacks.RemoveAll([CallbackID](const TPair<uint64, FOnAssetLoaded>& Callback)
+		{
+			return Callback.Key == CallbackID;
+		});
+	}
+}
+
+UObject* FRuntimeAssetCache::Find(const FSoftObjectPath& Path) const
+{
+	const FEntry* Entry = Entries.Find(Path);
+	return Entry && !Entry->bLoading ? Entry->Asset.Get() : nullptr;
+}
+
+bool FRuntimeAssetCache::IsLoading(const FSoftObjectPath& Path) const
+{
+	const FEntry* Entry = Entries.Find(Path);
+	return Entry && Entry->bLoading;
+}
+
+int32 FRuntimeAssetCache::GetRefCount(const FSoftObjectPath& Path) const
+{
+	const FEntry* Entry = Entries.Find(Path);
+	return Entry ? Entry->RefCount : 0;
+}
+
+void FRuntimeAssetCache::FlushUnreferenced()
+{
+	while (UnreferencedLRU.Num() > 0)
+	{
+		Evict(UnreferencedLRU[0]);
+	}
+	UpdateTicker();
+}
+
+void FRuntimeAssetCache::Shutdown()
+{
+	for (TPair<FSoftObjectPath, FEntry>& Pair : Entries)
+	{
+		Pair.Value.Callbacks.Reset();
+		if (Pair.Value.Handle.IsValid())
+		{
+			Pair.Value.Handle->ReleaseHandle();
+		}
+	}
+	Entries.Reset();
+	UnreferencedLRU.Reset();
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+	SET_DWORD_STAT(STAT_LiquidSharedAssets, 0);
+}
+
+void FRuntimeAssetCache::OnLoadCompleted(FSoftObjectPath Path)
+{
+	FEntry* Entry = Entries.Find(Path);
+	if (Entry == nullptr || !Entry->bLoading)
+	{
+		return;
+	}
+	Entry->bLoading = false;
+	Entry->Asset = Entry->Handle.IsValid() ? Entry->Handle->GetLoadedAsset() : Path.ResolveObject();
+	if (!Entry->Asset.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("[FRuntimeAssetCache] Failed to load asset: %s"), *Path.ToString());
+		//note: 失敗したハンドルは保持しない。参照カウントはそのままで、次の Acquire で RequestAsyncLoad し直す
+		if (Entry->Handle.IsValid())
+		{
+			Entry->Handle->ReleaseHandle();
+			Entry->Handle.Reset();
+		}
+	}
+
+	//コールバック内で Acquire / Release されても良いように取り出してから呼ぶ
+	UObject* Asset = Entry->Asset.Get();
+	TArray<TPair<uint64, FOnAssetLoaded>> Callbacks = MoveTemp(Entry->Callbacks);
+	for (TPair<uint64, FOnAssetLoaded>& Callback : Callbacks)
+	{
+		Callback.Value(Asset);
+	}
+}
+
+void FRuntimeAssetCache::Evict(const FSoftObjectPath& Path)
+{
+	UnreferencedLRU.RemoveSingle(Path);
+	FEntry Entry;
+	if (!Entries.RemoveAndCopyValue(Path, Entry))
+	{
+		return;
+	}
+	//ロード中に全て Release されたものはキャンセル
+	if (Entry.Handle.IsValid())
+	{
+		if (Entry.bLoading)
+		{
+			Entry.Handle->CancelHandle();
+		}
+		else
+		{
+			Entry.Handle->ReleaseHandle();
+		}
+	}
+	SET_DWORD_STAT(STAT_LiquidSharedAssets, Entries.Num());
+}
+
+bool FRuntimeAssetCache::Tick(float DeltaTime)
+{
+	const double ExpireTime = FPlatformTime::Seconds() - CVarRuntimeAssetCacheGracePeriod.GetValueOnGameThread();
+	//LRU は解放された順なので先頭から期限切れを解放する
+	while (UnreferencedLRU.Num() > 0)
+	{
+		const FEntry* Entry = Entries.Find(UnreferencedLRU[0]);
+		if (Entry && Entry->ReleasedTime > ExpireTime)
+		{
+			break;
+		}
+		Evict(UnreferencedLRU[0]);
+	}
+	if (UnreferencedLRU.Num() == 0)
+	{
+		TickerHandle.Reset();
+		return false;
+	}
+	return true;
+}
+
+void FRuntimeAssetCache::UpdateTicker()
+{
+	if (UnreferencedLRU.Num() > 0 && !TickerHandle.IsValid())
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(
+			FTickerDelegate::CreateRaw(this, &FRuntimeAssetCache::Tick), 1.0f);
+	}
+	else if (UnreferencedLRU.Num() == 0 && TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+}
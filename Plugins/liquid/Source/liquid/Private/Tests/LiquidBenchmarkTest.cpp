@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LiquidBenchmark.h"
+#include "PostProcessCallSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/*
+ * 結果が環境に依存しにくいベンチマークのオートメーションテスト
+ *
+ * - Liquid.Benchmark.TransientTasks : ロード済みの最初のポストプロセスで liquid.Benchmark.TransientTasks を実行する
+ * - Liquid.Benchmark.AssetLoad.*    : liquid.Benchmark.AssetLoad を Default / Shared / Batch で実行する
+ * - Liquid.Benchmark.AssetPtrStress : liquid.Benchmark.AssetPtrStress を実行する
+ *
+ * 閾値(liquid.Benchmark.Max*)を超えた結果・遅れて届いたコールバック等はテストのエラーとして報告する。
+ * 実行例: -ExecCmds="Automation RunTests Liquid"
+ */
+namespace LiquidBenchmarkTest
+{
+	static TAutoConsoleVariable<FString> CVarAssetPath(
+		TEXT("liquid.Benchmark.Test.AssetPath"), TEXT("/liquid"),
+		TEXT("Package path used by Liquid.Benchmark.AssetLoad and Liquid.Benchmark.AssetPtrStress automation tests."));
+
+	struct FState
+	{
+		bool bFinished = false;
+	};
+
+	/**
+	 * @brief ベンチマークの結果をテストへ報告する OnFinished を作成する。
+	 */
+	LiquidBenchmark::FOnFinished MakeOnFinished(FAutomationTestBase* Test, const TSharedRef<FState>& State)
+	{
+		return [Test, State](const LiquidBenchmark::FReport& Report)
+		{
+			for (const FString& Failure : Report.GetFailures())
+			{
+				Test->AddError(FString::Printf(TEXT("%s: %s"), *Report.GetSuiteName(), *Failure));
+			}
+			State->bFinished = true;
+		};
+	}
+
+	UWorld* FindPostProcessWorld()
+	{
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			UWorld* World = Context.World();
+			if (World && World->GetSubsystem<UPostProcessCallSubsystem>())
+			{
+				return World;
+			}
+		}
+		return nullptr;
+	}
+}
+
+//note: タイムアウトはベンチマーク側(liquid.Benchmark.TimeoutSeconds)で判定するため、ここでは終了のみ待つ
+DEFINE_LATENT_AUTOMATION_COMMAND_ONE_PARAMETER(FLiquidWaitForBenchmarkCommand, TSharedRef<LiquidBenchmarkTest::FState>, State);
+
+bool FLiquidWaitForBenchmarkCommand::Update()
+{
+	return State->bFinished;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLiquidBenchmarkTransientTasksTest, "Liquid.Benchmark.TransientTasks",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FLiquidBenchmarkTransientTasksTest::RunTest(const FString& Parameters)
+{
+	using namespace LiquidBenchmarkTest;
+
+	UWorld* World = FindPostProcessWorld();
+	if (!World)
+	{
+		AddError(TEXT("No world has UPostProcessCallSubsystem"));
+		return false;
+	}
+	const TSharedRef<FState> State = MakeShared<FState>();
+	LiquidBenchmark::RunTransientTasks(World, NAME_None, 120, MakeOnFinished(this, State));
+	ADD_LATENT_AUTOMATION_COMMAND(FLiquidWaitForBenchmarkCommand(State));
+	return true;
+}
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FLiquidBenchmarkAssetLoadTest, "Liquid.Benchmark.AssetLoad",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+void FLiquidBenchmarkAssetLoadTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const TCHAR* Mode : {TEXT("Default"), TEXT("Shared"), TEXT("Batch")})
+	{
+		OutBeautifiedNames.Add(Mode);
+		OutTestCommands.Add(Mode);
+	}
+}
+
+bool FLiquidBenchmarkAssetLoadTest::RunTest(const FString& Parameters)
+{
+	using namespace LiquidBenchmarkTest;
+
+	//note: 前のモードでロードされたアセットが AlreadyLoaded として計測から外れないよう、先に解放しておく
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	const TSharedRef<FState> State = MakeShared<FState>();
+	LiquidBenchmark::RunAssetLoad(CVarAssetPath.GetValueOnGameThread(), 0, Parameters, MakeOnFinished(this, State));
+	ADD_LATENT_AUTOMATION_COMMAND(FLiquidWaitForBenchmarkCommand(State));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLiquidBenchmarkAssetPtrStressTest, "Liquid.Benchmark.AssetPtrStress",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FLiquidBenchmarkAssetPtrStressTest::RunTest(const FString& Parameters)
+{
+	using namespace LiquidBenchmarkTest;
+
+	const TSharedRef<FState> State = MakeShared<FState>();
+	LiquidBenchmark::RunAssetPtrStress(CVarAssetPath.GetValueOnGameThread(), 120, 32, MakeOnFinished(this, State));
+	ADD_LATENT_AUTOMATION_COMMAND(FLiquidWaitForBenchmarkCommand(State));
+	return true;
+}
+
+#endif
@@ -0,0 +1,138 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PostProcessCallSubsystem.h"
+#include "Misc/AutomationTest.h"
+#include "Curves/CurveFloat.h"
+#include "Engine/DataTable.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/*
+ * FPostProcessCurveTable のベイク誤差のテスト
+ *
+ * - Liquid.PostProcess.CurveTable.KnownCurves    : 既知のカーブでベイク・評価・誤差計測が正しいことを確認する
+ * - Liquid.PostProcess.CurveTable.ConfiguredRows : PostProcessTables の bUseBakedCurves の行が BakedCurveResolution で許容誤差以内か確認する
+ *
+ * 実行例: -ExecCmds="Automation RunTests Liquid"
+ */
+namespace LiquidCurveTableTest
+{
+	UCurveFloat* CreateCurve(std::initializer_list<TPair<float, float>> Keys, ERichCurveInterpMode InterpMode)
+	{
+		UCurveFloat* Curve = NewObject<UCurveFloat>(GetTransientPackage());
+		for (const TPair<float, float>& Key : Keys)
+		{
+			const FKeyHandle Handle = Curve->FloatCurve.AddKey(Key.Key, Key.Value);
+			Curve->FloatCurve.SetKeyInterpMode(Handle, InterpMode);
+		}
+		return Curve;
+	}
+
+	float MeasureError(const UCurveFloat* Curve, int32 Resolution)
+	{
+		FPostProcessCurveTable Table;
+		Table.Bake(Curve, Resolution);
+		return Table.MeasureMaxError(Curve, Resolution * FPostProcessCurveTable::ErrorStepsPerSample);
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLiquidCurveTableKnownCurvesTest, "Liquid.PostProcess.CurveTable.KnownCurves",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FLiquidCurveTableKnownCurvesTest::RunTest(const FString& Parameters)
+{
+	using namespace LiquidCurveTableTest;
+
+	FPostProcessCurveTable Empty;
+	Empty.Bake(nullptr, 64);
+	TestFalse(TEXT("Baking a null curve leaves the table empty"), Empty.IsBaked());
+
+	//直線は最小のサンプル数でも誤差なし
+	const UCurveFloat* Ramp = CreateCurve({{.0f, .0f}, {1.0f, 1.0f}}, RCIM_Linear);
+	TestTrue(TEXT("Linear ramp is exact at resolution 2"), MeasureError(Ramp, 2) <= KINDA_SMALL_NUMBER);
+
+	//山型のカーブ: 端点は元カーブと一致し、既定のサンプル数では許容誤差以内、粗いサンプル数では超過する
+	const UCurveFloat* Bell = CreateCurve({{.0f, .0f}, {.5f, 1.0f}, {1.0f, .0f}}, RCIM_Cubic);
+	const float Tolerance = FPostProcessCurveTable::GetErrorTolerance(Bell);
+	FPostProcessCurveTable Table;
+	Table.Bake(Bell, 64);
+	TestEqual(TEXT("Start sample matches the curve"), Table.Evaluate(.0f), Bell->GetFloatValue(.0f), KINDA_SMALL_NUMBER);
+	TestEqual(TEXT("End sample matches the curve"), Table.Evaluate(1.0f), Bell->GetFloatValue(1.0f), KINDA_SMALL_NUMBER);
+
+	const float DefaultError = MeasureError(Bell, 64);
+	const float CoarseError = MeasureError(Bell, 4);
+	TestTrue(FString::Printf(TEXT("Bell curve at resolution 64 is within tolerance (Error: %f Tolerance: %f)"), DefaultError, Tolerance),
+		DefaultError <= Tolerance);
+	TestTrue(FString::Printf(TEXT("Bell curve at resolution 4 exceeds tolerance (Error: %f Tolerance: %f)"), CoarseError, Tolerance),
+		CoarseError > Tolerance);
+	TestTrue(TEXT("Error decreases as resolution increases"), MeasureError(Bell, 256) <= DefaultError);
+
+	//許容誤差は値域に比例する
+	const UCurveFloat* WideRamp = CreateCurve({{.0f, .0f}, {1.0f, 10.0f}}, RCIM_Linear);
+	TestEqual(TEXT("Tolerance scales with the value range"), FPostProcessCurveTable::GetErrorTolerance(WideRamp),
+		FPostProcessCurveTable::ErrorToleranceRatio * 10.0f, KINDA_SMALL_NUMBER);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLiquidCurveTableConfiguredRowsTest, "Liquid.PostProcess.CurveTable.ConfiguredRows",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ProductFilter)
+
+bool FLiquidCurveTableConfiguredRowsTest::RunTest(const FString& Parameters)
+{
+	using namespace LiquidCurveTableTest;
+
+	TArray<FSoftObjectPath> TablePaths;
+	UPostProcessCallSubsystem::GatherConfiguredPostProcessTablePaths(TablePaths);
+	if (TablePaths.IsEmpty())
+	{
+		AddInfo(TEXT("PostProcessTables is not configured"));
+		return true;
+	}
+
+	int32 NumCheckedCurves = 0;
+	for (const FSoftObjectPath& TablePath : TablePaths)
+	{
+		const UDataTable* Table = Cast<UDataTable>(TablePath.TryLoad());
+		if (!Table)
+		{
+			AddError(FString::Printf(TEXT("Failed to load %s"), *TablePath.ToString()));
+			continue;
+		}
+		Table->ForeachRow<FTransientPostProcessConfig>(TEXT("FLiquidCurveTableConfiguredRowsTest"),
+			[this, Table, &NumCheckedCurves](const FName& EffectID, const FTransientPostProcessConfig& Config)
+			{
+				if (!Config.bUseBakedCurves)
+				{
+					return;
+				}
+				auto Check = [this, Table, &NumCheckedCurves, &EffectID, &Config](const UCurveFloat* Curve)
+				{
+					if (!Curve)
+					{
+						return;
+					}
+					++NumCheckedCurves;
+					const float Error = MeasureError(Curve, Config.BakedCurveResolution);
+					const float Tolerance = FPostProcessCurveTable::GetErrorTolerance(Curve);
+					if (Error > Tolerance)
+					{
+						AddError(FString::Printf(TEXT("%s %s: baked curve %s exceeds tolerance at BakedCurveResolution %d (Error: %f Tolerance: %f)"),
+							*Table->GetName(), *EffectID.ToString(), *Curve->GetName(), Config.BakedCurveResolution, Error, Tolerance));
+					}
+				};
+				for (const FPostProcessControlParams& Parameters : Config.ControlParameters)
+				{
+					if (Parameters.MaterialParameterName != NAME_None)
+					{
+						Check(Parameters.NormalizedFloatCurve);
+					}
+				}
+				Check(Config.NormalizedWeightCurve);
+			});
+	}
+	AddInfo(FString::Printf(TEXT("Checked %d baked curves"), NumCheckedCurves));
+	return true;
+}
+
+#endif
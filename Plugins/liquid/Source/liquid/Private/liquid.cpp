@@ -2,6 +2,27 @@
 
 #include "liquid.h"
 #include "ShaderCore.h"
+#include "LiquidStats.h"
+#include "RuntimeAssetCache.h"
+#include "EffectPlaylistDiscovery.h"
+#include "LiquidAllocationCounter.h"
+
+DEFINE_STAT(STAT_LiquidPostActorTick);
+DEFINE_STAT(STAT_LiquidTaskTick);
+DEFINE_STAT(STAT_LiquidEvaluateCurves);
+DEFINE_STAT(STAT_LiquidAcquireMID);
+DEFINE_STAT(STAT_LiquidLoadCallback);
+DEFINE_STAT(STAT_LiquidDisplaySpawn);
+DEFINE_STAT(STAT_LiquidDisplayRelease);
+DEFINE_STAT(STAT_LiquidActiveTasks);
+DEFINE_STAT(STAT_LiquidCachedMaterials);
+DEFINE_STAT(STAT_LiquidSharedAssets);
+DEFINE_STAT(STAT_LiquidPSOWarmupTasks);
+DEFINE_STAT(STAT_LiquidLoadRetries);
+DEFINE_STAT(STAT_LiquidEffectBundleMemory);
+
+UE_TRACE_CHANNEL_DEFINE(LiquidChannel);
+CSV_DEFINE_CATEGORY(Liquid, true);
 
 #define LOCTEXT_NAMESPACE "FliquidModule"
 
@@ -10,11 +31,15 @@ void FliquidModule::StartupModule()
 	const FString ShaderDirectory = FPaths::Combine(FPaths::ProjectPluginsDir(), TEXT("liquid"), TEXT("Shaders"));
 	if(!AllShaderSourceDirectoryMappings().Contains("/liquid/Shaders"))
 		AddShaderSourceDirectoryMapping("/liquid/Shaders", ShaderDirectory);
+#if !UE_BUILD_SHIPPING
+	FLiquidAllocationCounter::Install();
+#endif
 }
 
 void FliquidModule::ShutdownModule()
 {
-
+	FRuntimeAssetCache::Get().Shutdown();
+	FEffectPlaylistDiscovery::Get().Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -11,10 +11,106 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
 #include "Engine/StreamableManager.h"
+#include "RuntimeAssetBatch.h"
+#include "LiquidEffectBundle.h"
 #include "EffectDisplayActor.generated.h"
 
 class UNiagaraComponent;
 class UNiagaraSystem;
+class FEffectDisplayCapture;
+struct FEffectPlaylistAsset;
+
+/**
+ * AEffectDisplayActor のプレイリストの各エントリのロード状態
+ */
+enum class EPlaylistEntryState : uint8
+{
+	Unloaded,
+	Loading,
+	Loaded,
+	Failed, //リトライしてもロードできなかった (再生しない)
+};
+
+/**
+ * AEffectDisplayActor のフォルダから追加したエフェクトの並び順
+ */
+UENUM()
+enum class EEffectPlaylistSortMode : uint8
+{
+	None, //AssetRegistry の検索順 (実行毎に変わる場合がある)
+	Name,
+	SizeAscending, //パッケージのディスク上のサイズの昇順
+	SizeDescending,
+};
+
+/**
+ * AEffectDisplayActor のエフェクトを回転(周回)させる方法
+ */
+UENUM()
+enum class EEffectDisplayOrbitMode : uint8
+{
+	Transform, //RotationRoot を毎フレーム回転させる (NiagaraSystem の LocalSpace が必要)
+	UserParameter, //Spawn 時に Niagara のユーザーパラメータで周回の中心・軸・速度を渡し、システム側で回転させる (コンポーネントは動かさない)
+};
+
+/**
+ * AEffectDisplayActor の再生(Spawn)コストの統計
+ *  - Spawn / Release はコンポーネントの生成・アタッチ・有効化・停止にかかった時間で、表示台側のオーバーヘッド
+ *  - FirstFrame は Spawn 開始からシステムが最初に更新されるまでの時間で、エフェクト自体のコストを含む
+ */
+struct FEffectDisplaySpawnStats
+{
+	int32 NumSpawns = 0;
+	int32 NumPoolHits = 0; //コンポーネントプールから再利用できた回数
+	int32 NumFirstFrames = 0;
+	double TotalSpawnMs = .0;
+	double MaxSpawnMs = .0;
+	double TotalReleaseMs = .0;
+	double MaxReleaseMs = .0;
+	double TotalFirstFrameMs = .0;
+	double MaxFirstFrameMs = .0;
+
+	double GetAverageSpawnMs() const {return NumSpawns > 0 ? TotalSpawnMs / NumSpawns : .0;}
+	double GetAverageReleaseMs() const {return NumSpawns > 0 ? TotalReleaseMs / NumSpawns : .0;}
+	double GetAverageFirstFrameMs() const {return NumFirstFrames > 0 ? TotalFirstFrameMs / NumFirstFrames : .0;}
+	float GetPoolHitRate() const {return NumSpawns > 0 ? static_cast<float>(NumPoolHits) / NumSpawns : .0f;}
+	void Accumulate(const FEffectDisplaySpawnStats& Other)
+	{
+		NumSpawns += Other.NumSpawns;
+		NumPoolHits += Other.NumPoolHits;
+		NumFirstFrames += Other.NumFirstFrames;
+		TotalSpawnMs += Other.TotalSpawnMs;
+		MaxSpawnMs = FMath::Max(MaxSpawnMs, Other.MaxSpawnMs);
+		TotalReleaseMs += Other.TotalReleaseMs;
+		MaxReleaseMs = FMath::Max(MaxReleaseMs, Other.MaxReleaseMs);
+		TotalFirstFrameMs += Other.TotalFirstFrameMs;
+		MaxFirstFrameMs = FMath::Max(MaxFirstFrameMs, Other.MaxFirstFrameMs);
+	}
+};
+
+/**
+ * AEffectDisplayActor の再生スロット (グリッドの1マス)
+ *  - スロット毎に再生中のエントリと再生時間を持ち、空いたスロットがプレイリストの次のエントリを再生する
+ *  - InstancesPerSlot が2以上の場合は同じシステムを複数インスタンス再生する
+ */
+USTRUCT()
+struct FEffectDisplaySlot
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TObjectPtr<USceneComponent> PlaceRoot{}; //スロットの配置位置
+	UPROPERTY()
+	TArray<TObjectPtr<UNiagaraComponent>> Components{}; //再生中のNiagara (InstancesPerSlot 個)
+
+	int32 PlayIndex = -1; //再生中の Playlist の Index
+	double SpawnStartTime = .0; //Spawn開始時刻(FPlatformTime::Seconds)
+	double SpawnMs = .0; //全インスタンスのSpawn時間
+	double FirstFrameMs = -1.0; //初回フレームまでの時間(未到達の場合は負値)
+	bool bWaitingFirstFrame = false; //初回フレーム待ち
+
+	bool IsPlaying() const {return !Components.IsEmpty();}
+};
 
 UCLASS()
 class LIQUID_API AEffectDisplayActor : public AActor
@@ -27,17 +123,54 @@ public:
 #if	EFFECT_DISPLAY_ENABLED
 	
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Destroyed() override;
+	/** @return 最初の先読み範囲のロードが終了していれば true */
+	bool IsPlaylistLoaded() const {return PlaylistLoadSeconds >= .0f;}
+	/** @return BeginPlay からフォルダの検索が終了するまでの時間[秒] (未完了の場合は負値) */
+	float GetPlaylistDiscoverySeconds() const {return PlaylistDiscoverySeconds;}
+	/** @return BeginPlay から最初の先読み範囲のロードが終了するまでの時間[秒] (未完了の場合は負値) */
+	float GetPlaylistLoadSeconds() const {return PlaylistLoadSeconds;}
+	/** @return ロード済みのエフェクトの依存アセット(Niagara・マテリアル・テクスチャ) キーは Playlist の Index */
+	const TMap<int32, FLiquidEffectBundle>& GetLoadedPlaylistBundles() const {return LoadedPlayListBundles;}
+	/** @return 現在メモリ上に保持している Niagara システムの数 */
+	int32 GetNumResidentSystems() const {return LoadedPlayList.Num();}
+	/** @return Niagara システム名毎の再生コストの統計 */
+	const TMap<FName, FEffectDisplaySpawnStats>& GetSpawnStats() const {return SpawnStats;}
+	/** @return 全システムの再生コストの統計の合計 */
+	FEffectDisplaySpawnStats GetTotalSpawnStats() const;
+	/** @return 同時に再生するスロットの数 */
+	int32 GetNumSlots() const {return Slots.Num();}
+	/** @brief 再生中・次に再生するエフェクトのテクスチャの全Mipを常駐させる */
+	void RequestNextEffectTextureMips() const;
+	/** @return キャプチャモードでプレイリストを最後まで再生し、レポートを出力済みであれば true */
+	bool IsCaptureFinished() const {return bCaptureFinished;}
 protected:
 	virtual void Tick(float DeltaTime)override;
 	
 private:
-	void StopCurrentPlayEffect();
-	bool PlayNext();
+	/** @brief グリッドの各マスに再生スロットを生成する */
+	void CreateSlots();
+	/** @brief スロットの再生時間の判定と計測を行う */
+	void TickSlot(FEffectDisplaySlot& Slot);
+	void StopSlot(FEffectDisplaySlot& Slot);
+	bool PlayNext(FEffectDisplaySlot& Slot, int32 NextIndex);
 	void RotationNiagaraSystem(float DeltaTime)const ;
+	/** @brief OrbitMode が UserParameter の場合に、周回のユーザーパラメータを設定する */
+	void SetOrbitParameters(UNiagaraComponent* NiagaraComponent);
+	/** @brief フォルダの検索後(フォルダ未指定の場合は即座)にプレイリストの先読みを開始する */
 	void BeginLoadAsync();
-	void LoadNiagaraSystemAsync();
-	bool ShouldStartNextEffect();
+	/** @brief フォルダから見つかったエフェクトを絞り込み・並び替えてプレイリストへ追加する */
+	void AddDiscoveredAssets(const TArray<FEffectPlaylistAsset>& Assets);
+	void OnPlaylistReady();
+	/** @brief 再生位置に合わせて先読み範囲のロードと、再生位置から離れたエントリの解放を行う */
+	void UpdateLookAhead();
+	int32 GetNextPlayIndex(int32 FromIndex) const;
+	bool ShouldStartNextEffect(int32& OutNextIndex);
+	/** 再生開始後、最初にシステムが更新されたフレームで初回フレームまでの時間を記録 */
+	void RecordFirstFrame(FEffectDisplaySlot& Slot);
+	/** キャプチャモードのレポートを出力し、-unattended の場合は全ての表示台の終了後にアプリケーションを終了する */
+	void FinishCapture();
 	
 #endif //UPROPERTYマクロ関連はビルドから除外できないかったのでここまで
 private:
@@ -45,31 +178,79 @@ private:
 	TArray<TSoftObjectPtr<UNiagaraSystem>> Playlist{};
 	UPROPERTY(EditAnywhere, meta=(Tooltip = "PlayListに追加するNiagaraフォルダのパス"))
 	FString AdditionalNiagaraFolderPath{};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "フォルダから追加するエフェクトの並び順"))
+	EEffectPlaylistSortMode PlaylistSortMode{EEffectPlaylistSortMode::Name};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "フォルダから追加するエフェクトを AssetRegistry のタグで絞り込む (値が空の場合はタグの有無のみ判定)"))
+	TMap<FName, FString> PlaylistTagFilter{};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "フォルダから追加するエフェクトのパッケージサイズの上限(KB) ※0で無制限", ClampMin = "0"))
+	int32 MaxPlaylistAssetKilobytes{0};
 	UPROPERTY(EditAnywhere, meta=(Tooltip = "再生位置のオフセット"))
 	FVector PlaceOffset{200.0,.0,100.0};
 	UPROPERTY(EditAnywhere, meta=(Tooltip = "回転時の半径"))
 	float RotationRadius{.0f};
-	UPROPERTY(EditAnywhere, meta=(Tooltip = "1秒あたりの回転角度(度) ※NiagaraSystemのLocalSpaceをONにしないと回転しません"))
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "1秒あたりの回転角度(度) ※OrbitModeがTransformの場合、NiagaraSystemのLocalSpaceをONにしないと回転しません"))
 	float RotateSpeed{.0f};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "回転の方法 UserParameter: Spawn時にユーザーパラメータ OrbitCenter(Position)・OrbitAxis(Vector)・OrbitSpeed(float 度/秒)・OrbitStartAngle(float 度) を設定し、コンポーネントのTransformは更新しない ※パラメータを公開していないシステムは回転しない"))
+	EEffectDisplayOrbitMode OrbitMode{EEffectDisplayOrbitMode::Transform};
 	UPROPERTY(EditAnywhere, meta=(Tooltip = "1つあたりのエフェクトの再生時間"))
 	float PlayInterval{5.0f};
 	//UPROPERTY(EditAnywhere, meta=(Tooltip = "ゲーム再生時に自動で登録したエフェクトを再生する"))
 	//bool IsAutoPlay{true};
 	UPROPERTY(EditAnywhere, meta=(Tooltip = "ループ再生を行うかどうか"))
 	bool IsLoop{true};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "ロードに失敗したエフェクトを再ロードする回数 ※超えたエフェクトは再生せずに飛ばす", ClampMin = "0"))
+	int32 MaxLoadRetryCount{2};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "再生位置から先読みして並列にロードしておくエフェクトの数", ClampMin = "1"))
+	int32 LookAheadCount{4};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "再生済みのエフェクトを解放せずに保持しておく数 ※これより前のエフェクトは解放する", ClampMin = "0"))
+	int32 KeepBehindCount{1};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "再生中・次に再生するエフェクトが使用するテクスチャの全Mipを事前に常駐させる(再生開始時のMipのポップを防ぐ)"))
+	bool bPreloadTextureMips{true};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "プレイリストを1周再生しながらエフェクト毎の負荷(スレッド時間・パーティクル数・メモリ・Spawn時間)を計測し、Saved/Profiling/LiquidEffectCaptureへCSVで出力する ※コマンドライン引数 -LiquidEffectCapture で全ての表示台を有効化"))
+	bool bCaptureMode{false};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "キャプチャモードで最初のエフェクトを再生する前に、エフェクト無しの負荷を計測する時間(秒)", EditCondition = "bCaptureMode", ClampMin = "0"))
+	float CaptureBaselineSeconds{2.0f};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "Niagaraのコンポーネントプールを使用して、再生毎のコンポーネントの生成・破棄を避ける ※プールの上限はNiagaraSystemのMaxPoolSizeに従う"))
+	bool bUseComponentPool{true};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "同時に再生するグリッドの列数(右方向) ※キャプチャモードでは1x1", ClampMin = "1"))
+	int32 GridColumns{1};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "同時に再生するグリッドの行数(前方向) ※キャプチャモードでは1x1", ClampMin = "1"))
+	int32 GridRows{1};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "グリッドの間隔 (X:行 Y:列)"))
+	FVector2D GridSpacing{300.0, 300.0};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "1つのスロットで同じエフェクトを同時に再生する数 ※インスタンス数に対する負荷のスケールの計測用", ClampMin = "1"))
+	int32 InstancesPerSlot{1};
+	UPROPERTY(EditAnywhere, meta=(Tooltip = "同じスロット内のインスタンス毎の配置オフセット"))
+	FVector InstanceOffset{.0, .0, .0};
 	
 	UPROPERTY()
 	TObjectPtr<USceneComponent> RotationRoot{};	//NiagaraComponent自身を回転させてもSystemが回らなかったので親子関係で回転させる
 	UPROPERTY()
 	TObjectPtr<USceneComponent> PlaceRoot{};	//実際のNiagaraComponent配置位置(RotationRadius)
 	UPROPERTY()
-	TObjectPtr<UNiagaraComponent> NiagaraComponent{}; //再生中のNiagara
-	TSharedPtr<FStreamableHandle> CurrentLoadingHandle{};
+	TArray<FEffectDisplaySlot> Slots{}; //グリッドの各マスの再生スロット
+	TRuntimeAssetBatch<UNiagaraSystem> PlaylistBatch{}; //先読み範囲をまとめてロードする
+	TArray<int32> LoadingIndices{}; //PlaylistBatch の要素に対応する Playlist の Index
+	TArray<EPlaylistEntryState> EntryStates{}; //Playlist と同じ並び
 	UPROPERTY()
-	TArray<TObjectPtr<UNiagaraSystem>> LoadedPlayList{};
+	TMap<int32, TObjectPtr<UNiagaraSystem>> LoadedPlayList{}; //キーは Playlist の Index
+	TMap<int32, FLiquidEffectBundle> LoadedPlayListBundles{}; //LoadedPlayList の依存アセット
+	TMap<FName, FEffectDisplaySpawnStats> SpawnStats{}; //Niagara システム名毎の再生コスト
+	TSet<TWeakObjectPtr<UNiagaraComponent>> SpawnedComponents{}; //プールからの再利用判定用
 
-	int32 CurrentPlayIndex{-1}; //再生中のPlaylistArray Index
-	int32 CurrentLoadingIndex{0}; //ロード中のIndex
+	int32 CurrentPlayIndex{-1}; //最後に再生を開始した Playlist の Index (スロット共通の再生位置)
+	double LoadStartTime{.0}; //プレイリストのロード開始時刻(FPlatformTime::Seconds)
+	float PlaylistLoadSeconds{-1.0f}; //プレイリストのロード時間
+	float PlaylistDiscoverySeconds{-1.0f}; //フォルダの検索時間
+	uint64 DiscoveryCallbackID{0}; //フォルダの検索完了のコールバックの登録ID
+	bool bDiscoveringPlaylist{false}; //フォルダの検索中 (完了までプレイリストは確定しない)
+	float OrbitAngle{.0f}; //UserParameter モードの累積の回転角度(度) ※次に Spawn するエフェクトの開始角度
+	TSet<FName> OrbitWarnedSystems{}; //周回のユーザーパラメータを公開していない警告を出したシステム
+	bool bPlaylistFinished{false}; //ループしない場合に最後まで再生した
+	TSharedPtr<FEffectDisplayCapture> Capture{}; //キャプチャモードの計測結果
+	double CaptureBaselineEndTime{.0}; //ベースライン計測の終了時刻(FPlatformTime::Seconds)
+	bool bCaptureFinished{false};
+	bool bCaptureSucceeded{false}; //レポートを出力でき、プレイリストが空でなかった
 	
 	static constexpr int32 PlaylistReserveCapacity = 64;
 	static constexpr int32 InvalidPlayIndex = -1;
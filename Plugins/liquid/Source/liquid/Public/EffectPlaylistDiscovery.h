@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AssetRegistry/AssetData.h"
+
+/**
+ * フォルダから見つかったエフェクトのアセット
+ */
+struct FEffectPlaylistAsset
+{
+	FAssetData AssetData{};
+	int64 DiskSize = 0; //パッケージのディスク上のサイズ[byte] (不明な場合は 0)
+};
+
+/**
+ * FEffectPlaylistDiscovery
+ *
+ *  - AEffectDisplayActor のプレイリストに追加する Niagara システムをフォルダから検索し、フォルダ毎にキャッシュする
+ *  - AssetRegistry のスキャン中はスキャンの完了(OnFilesLoaded)を待ってから検索するので、常にフォルダ内の全てのアセットが返る
+ *  - 検索はワーカースレッドで行い、結果はゲームスレッドのコールバックで返す
+ *  - キャッシュは Niagara システムが追加・削除・リネームされたフォルダのみ無効化する
+ *  - 同じフォルダへの検索要求は1つにまとめ、完了時に待機中の全てのコールバックを呼ぶ
+ *  ※ワーカースレッドで検索するためディスク上のアセットのみが対象 (エディタで未保存のアセットは含まない)
+ *  - ゲームスレッド専用
+ */
+class LIQUID_API FEffectPlaylistDiscovery
+{
+public:
+	using FOnDiscovered = TFunction<void(const TArray<FEffectPlaylistAsset>&)>;
+
+	static FEffectPlaylistDiscovery& Get();
+
+	/**
+	 * @brief フォルダ(サブフォルダを含む)の Niagara システムを検索する。
+	 * @param FolderPath 検索するフォルダ (例: /Game/Effects)
+	 * @param Callback 検索完了時のコールバック。キャッシュ済みの場合はこの関数内で呼ばれる。
+	 * @return コールバックの登録ID。検索完了前に CancelCallback で登録解除できる。(この関数内で呼ばれた場合は 0)
+	 */
+	uint64 DiscoverAsync(const FString& FolderPath, FOnDiscovered Callback);
+
+	/**
+	 * @brief 検索完了前のコールバックを登録解除する。(検索自体は継続し、結果はキャッシュされる)
+	 */
+	void CancelCallback(const FString& FolderPath, uint64 CallbackID);
+
+	/**
+	 * @brief キャッシュ済みの検索結果を返す。未検索・検索中・無効化済みの場合は nullptr
+	 */
+	const TArray<FEffectPlaylistAsset>* FindCached(const FString& FolderPath) const;
+
+	/**
+	 * @brief 全てのキャッシュを破棄する。
+	 */
+	void Invalidate();
+
+	/**
+	 * @brief 全てのエントリと AssetRegistry のイベントを解除する。(モジュール終了時用)
+	 */
+	void Shutdown();
+
+private:
+	struct FEntry
+	{
+		TArray<FEffectPlaylistAsset> Assets;
+		TArray<TPair<uint64, FOnDiscovered>> Callbacks;
+		uint32 Generation = 0; //無効化の度に増やし、検索中に無効化された結果を破棄する
+		double QueryStartTime = .0;
+		bool bQuerying = false;
+		bool bValid = false;
+	};
+
+	void StartQuery(const FString& FolderPath);
+	void OnQueryCompleted(const FString& FolderPath, uint32 Generation, TArray<FEffectPlaylistAsset>&& Assets);
+	void OnFilesLoaded();
+	void OnAssetChanged(const FAssetData& AssetData);
+	void OnAssetRenamed(const FAssetData& AssetData, const FString& OldObjectPath);
+	/** @brief PackagePath を含むフォルダのキャッシュを無効化する */
+	void InvalidatePackagePath(const FString& PackagePath);
+	void BindAssetEvents();
+
+	TMap<FString, FEntry> Entries;
+	FDelegateHandle FilesLoadedHandle;
+	FDelegateHandle AssetAddedHandle;
+	FDelegateHandle AssetRemovedHandle;
+	FDelegateHandle AssetRenamedHandle;
+	uint64 NextCallbackID = 1;
+};
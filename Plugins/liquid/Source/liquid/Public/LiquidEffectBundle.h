@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UCurveBase;
+class UMaterialInterface;
+class UNiagaraSystem;
+class UTexture;
+
+/**
+ * FLiquidEffectBundle
+ *
+ *  - 1つのエフェクトの再生に必要な依存アセット(マテリアル・テクスチャ・カーブ・Niagara)をまとめたもの
+ *  - マテリアル・Niagara からテクスチャを辿って収集し、同じアセットは一度だけ数える
+ *  - RequestTextureMips() で収集したテクスチャの全Mipを常駐させ、初回再生時のMipストリーミングによるポップ・ヒッチを防ぐ
+ *  - メモリ使用量は GetResourceSizeBytes(EstimatedTotal) による見積もり
+ *  ※アセット自体の参照は保持しない(マテリアル・Niagara の保持者が GC から保護すること)
+ */
+struct LIQUID_API FLiquidEffectBundle
+{
+	void AddMaterial(UMaterialInterface* Material);
+	void AddTexture(UTexture* Texture);
+	void AddCurve(UCurveBase* Curve);
+	/** Niagara システム本体と、全エミッタのレンダラーが使用するマテリアルを追加 */
+	void AddNiagaraSystem(UNiagaraSystem* NiagaraSystem);
+
+	/**
+	 * @brief 収集したテクスチャの全Mipを指定秒数の間、常駐させる。
+	 * @param Seconds 常駐させる時間[秒] (0 以下の場合は何もしない)
+	 */
+	void RequestTextureMips(float Seconds) const;
+
+	int64 GetTotalBytes() const { return MaterialBytes + TextureBytes + CurveBytes + NiagaraBytes; }
+	int32 GetNumAssets() const { return Visited.Num(); }
+	int32 GetNumTextures() const { return Textures.Num(); }
+	/** @return "Materials: 1 (12.3 KB) Textures: 4 (5.6 MB) ..." 形式の概要 */
+	FString ToString() const;
+
+	int32 NumMaterials = 0;
+	int32 NumCurves = 0;
+	int32 NumNiagaraSystems = 0;
+	int64 MaterialBytes = 0;
+	int64 TextureBytes = 0;
+	int64 CurveBytes = 0;
+	int64 NiagaraBytes = 0;
+
+private:
+	/** @return 初めて追加された場合 true */
+	bool MarkVisited(const UObject* Object);
+
+	TArray<TWeakObjectPtr<UTexture>> Textures{};
+	TSet<const UObject*> Visited{};
+};
@@ -0,0 +1,123 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Containers/Ticker.h"
+#include "Engine/StreamableManager.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "LiquidPSOWarmupSubsystem.generated.h"
+
+class UMaterialInterface;
+
+/**
+ * PSO ウォームアップで要求したマテリアルのパーミュテーション
+ */
+USTRUCT(BlueprintType)
+struct FLiquidPSOWarmupRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, meta=(ToolTip="要求したマテリアル"))
+	FSoftObjectPath Material{};
+
+	UPROPERTY(BlueprintReadOnly, meta=(ToolTip="マテリアルのパーミュテーション (例: DefaultLit Opaque / Unlit Masked / PostProcess)"))
+	FString Permutation{};
+
+	UPROPERTY(BlueprintReadOnly, meta=(ToolTip="PSOを要求した頂点ファクトリ (PostProcess の場合は None)"))
+	FName VertexFactory = NAME_None;
+
+	UPROPERTY(BlueprintReadOnly, meta=(ToolTip="発行されたPSOコンパイルタスクの数"))
+	int32 NumPSOTasks = 0;
+
+	UPROPERTY(BlueprintReadOnly, meta=(ToolTip="実際にRHIへ要求した場合 true (NullRHI・PSOプリキャッシュ無効時は記録のみで false)"))
+	bool bPrecached = false;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnLiquidPSOWarmupCompleted);
+
+/**
+ * liquid のマテリアル・ポストプロセスマテリアルの PSO を事前に要求する Game Instance Subsystem
+ *
+ *  - RootMaterialPaths 以下のマテリアルと、UPostProcessCallSubsystem のデータテーブルの全行のマテリアルが対象
+ *  - 起動時(ロード画面中)にマテリアルを非同期ロードし、VertexFactoryTypeNames の頂点ファクトリで PSO のプリキャッシュを要求する
+ *  - 全ての PSO コンパイルタスクの完了を OnPSOWarmupCompleted で通知し、進捗は GetWarmupProgress で取得する
+ *  - NullRHI 等で PSO プリキャッシュが無効な場合は要求するパーミュテーションの記録のみ行う (GetRequests で取得)
+ *  ※ポストプロセスマテリアルはメッシュパスを持たず PSO プリキャッシュの対象外のため、パーミュテーションの記録のみ行う
+ *    (シェーダーマップの準備は待たず、進捗・完了通知にも含まれない)
+ */
+UCLASS(Config=Game)
+class LIQUID_API ULiquidPSOWarmupSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/**
+	 * @brief ウォームアップを開始する。実行中・完了済みの場合は何もしない。
+	 */
+	UFUNCTION(BlueprintCallable, Category="PostProcess", meta=(ToolTip="liquidのマテリアル・ポストプロセスマテリアルのPSOウォームアップを開始します"))
+	void StartPSOWarmup();
+
+	/** @return 0～1 の進捗 (マテリアルのロードで 0.5、PSO コンパイルの完了で 1) */
+	UFUNCTION(BlueprintPure, Category="PostProcess", meta=(ToolTip="PSOウォームアップの進捗(0～1)を取得します"))
+	float GetWarmupProgress() const;
+
+	UFUNCTION(BlueprintPure, Category="PostProcess", meta=(ToolTip="PSOウォームアップが完了しているかどうか"))
+	bool IsWarmupComplete() const {return bComplete;}
+
+	UFUNCTION(BlueprintPure, Category="PostProcess", meta=(ToolTip="PSOウォームアップで要求したマテリアルのパーミュテーションを取得します"))
+	TArray<FLiquidPSOWarmupRequest> GetRequests() const {return Requests;}
+
+	bool IsWarmupRunning() const {return bRunning;}
+	/** @return 開始から完了までの時間[秒] (未完了の場合は負値) */
+	float GetWarmupSeconds() const {return WarmupSeconds;}
+
+	/** 全ての PSO コンパイルタスクが完了した時に呼ばれる */
+	UPROPERTY(BlueprintAssignable, Category="PostProcess")
+	FOnLiquidPSOWarmupCompleted OnPSOWarmupCompleted;
+
+private:
+	void OnTablesLoaded();
+	void OnMaterialsLoaded();
+	/** マテリアルのパーミュテーションを記録し、PSO のプリキャッシュを要求 */
+	void RequestMaterialPSOs(UMaterialInterface* Material, bool bCanPrecache);
+	bool Tick(float DeltaTime);
+	void CompleteWarmup();
+
+	/** @return "DefaultLit Opaque" / "Unlit Masked" / "PostProcess" 等 */
+	static FString GetPermutationName(const UMaterialInterface* Material);
+
+	/** Initialize 時にウォームアップを開始する */
+	UPROPERTY(Config)
+	bool bWarmupOnInitialize = true;
+	/** ウォームアップ対象のマテリアルのフォルダ (サブフォルダを含む) */
+	UPROPERTY(Config)
+	TArray<FString> RootMaterialPaths{TEXT("/liquid/materials/root_materials")};
+	/** PSO を要求する頂点ファクトリ (スタティックメッシュ・Niagara のスプライト・メッシュ・リボン) */
+	UPROPERTY(Config)
+	TArray<FString> VertexFactoryTypeNames{
+		TEXT("FLocalVertexFactory"),
+		TEXT("FNiagaraSpriteVertexFactory"),
+		TEXT("FNiagaraMeshVertexFactory"),
+		TEXT("FNiagaraRibbonVertexFactory")};
+
+	/** データテーブル・マテリアルのロード ※PSO のコンパイル完了後に解放する (コンパイル済みの PSO はキャッシュに残る) */
+	TSharedPtr<FStreamableHandle> TablesHandle{};
+	TSharedPtr<FStreamableHandle> MaterialsHandle{};
+	TArray<FSoftObjectPath> MaterialPaths{};
+	TArray<FLiquidPSOWarmupRequest> Requests{};
+	/** 未完了の PSO コンパイルタスク */
+	FGraphEventArray PendingPSOTasks{};
+	int32 NumPSOTasks = 0;
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	double StartTime = .0;
+	float WarmupSeconds = -1.0f;
+	bool bRunning = false;
+	bool bMaterialsLoaded = false;
+	bool bComplete = false;
+};
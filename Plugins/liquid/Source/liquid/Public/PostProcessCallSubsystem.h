@@ -3,11 +3,18 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "LiquidEffectBundle.h"
 #include "Subsystems/WorldSubsystem.h"
 #include "Engine/StreamableManager.h"
 #include "Engine/Scene.h"
 #include "PostProcessCallSubsystem.generated.h"
 
+class APlayerCameraManager;
+class APlayerController;
+class AController;
+class AGameModeBase;
+class ULocalPlayer;
+
 /**
  * PostprocessMaterialの（float）パラメータをカーブで制御するための構造体
  */
@@ -23,7 +30,30 @@ struct FPostProcessControlParams
 };
 
 /**
- * データテーブル(UPostProcessCallSubsystem::PostProcessTable)で定義されるポストプロセスエフェクト構成情報
+ * ポストプロセスマテリアルのロードタイミング
+ */
+UENUM(BlueprintType)
+enum class ETransientPostProcessLoadPolicy : uint8
+{
+	Eager			UMETA(ToolTip="サブシステム初期化時にロードし、常駐させる"),
+	Lazy			UMETA(ToolTip="初回再生時にロードし、一定時間未使用なら解放する"),
+	PreloadByTag	UMETA(ToolTip="PreloadTransientPostProcessByTagでPreloadTagが指定された時にロードし、一定時間未使用なら解放する"),
+};
+
+/**
+ * 同時実行数の上限(MaxTransientTasks / MaxConcurrentInstances)に達した時の動作
+ */
+UENUM(BlueprintType)
+enum class ETransientPostProcessOverflowPolicy : uint8
+{
+	RejectNewest			UMETA(ToolTip="新しい再生要求を破棄する"),
+	EvictLowestPriority		UMETA(ToolTip="Priorityが最も低い(先に適用される)タスクを終了する。新しい要求の方が低い場合は新しい要求を破棄する"),
+	EvictOldest				UMETA(ToolTip="経過時間が最も長いタスクを終了する"),
+	RestartSameEffect		UMETA(ToolTip="同じEffectIDの再生中タスクを最初から再生し直す。存在しない場合は新しい要求を破棄する"),
+};
+
+/**
+ * データテーブル(UPostProcessCallSubsystem::PostProcessTables)で定義されるポストプロセスエフェクト構成情報
  */
 USTRUCT(BlueprintType)
 struct FTransientPostProcessConfig : public FTableRowBase
@@ -34,10 +64,22 @@ struct FTransientPostProcessConfig : public FTableRowBase
 
 	UPROPERTY(EditAnywhere,BlueprintReadOnly, meta=(ToolTip="適用順序のプライオリティ(低いほど先に実行されます)"))
 	int32 Priority = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(ToolTip="マテリアルのロードタイミング"))
+	ETransientPostProcessLoadPolicy LoadPolicy = ETransientPostProcessLoadPolicy::Eager;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(EditCondition="LoadPolicy==ETransientPostProcessLoadPolicy::PreloadByTag", ToolTip="PreloadTransientPostProcessByTagで指定するタグ"))
+	FName PreloadTag = NAME_None;
 	
 	UPROPERTY(EditAnywhere,BlueprintReadOnly, meta=(ToolTip="適用する時間"))
 	float Duration = 2.0f;
 
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(ClampMin=0, ToolTip="このエフェクトの同時再生数の上限(0で無制限) 上限時の動作はサブシステムのOverflowPolicyに従う"))
+	int32 MaxConcurrentInstances = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, meta=(ClampMin=0, Units="s", ToolTip="再生してから次の再生要求を受け付けるまでの時間(0で制限しない) この間の再生要求は破棄する"))
+	float RetriggerCooldown = .0f;
+
 	UPROPERTY(EditAnywhere,meta=(ToolTip="このポストプロセスのアルファ値の初期値(0で何もしない、1で完全適用)Weightをコントロールするカーブアセット"))
 	float InitialWeight = 1.0f;
 	/**
@@ -49,6 +91,105 @@ struct FTransientPostProcessConfig : public FTableRowBase
 	/** カーブ制御により変更するスカラーパラメータリスト */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly,meta=(ToolTip="操作するマテリアルパラメータ"))
 	TArray<FPostProcessControlParams> ControlParameters;
+
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0, ToolTip="マテリアルのロード完了時に事前生成しておくMaterialInstanceDynamicの数"))
+	int32 PoolWarmupCount = 0;
+
+	UPROPERTY(EditAnywhere, meta=(ClampMin=0, ToolTip="再利用のためにプールしておくMaterialInstanceDynamicの最大数(0でプールしない)"))
+	int32 PoolCapacity = 4;
+
+	UPROPERTY(EditAnywhere, meta=(ToolTip="マテリアルのロード完了時にカーブを固定解像度のテーブルへベイクし、毎フレームのカーブ評価を省略します"))
+	bool bUseBakedCurves = false;
+
+	UPROPERTY(EditAnywhere, meta=(ClampMin=2, ClampMax=1024, EditCondition="bUseBakedCurves", ToolTip="カーブをベイクする際のサンプル数"))
+	int32 BakedCurveResolution = 64;
+
+	UPROPERTY(EditAnywhere, meta=(ToolTip="マテリアルのロード完了時と再生時に、マテリアルが参照するテクスチャの全Mipを常駐させます(初回再生時のMipのポップを防ぎます)"))
+	bool bPreloadTextureMips = false;
+};
+
+/**
+ * MaterialInstanceDynamic プールの統計情報
+ */
+USTRUCT(BlueprintType)
+struct FPostProcessMaterialPoolStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, meta=(ToolTip="プールから再利用できた回数"))
+	int32 Hits = 0;
+	UPROPERTY(BlueprintReadOnly, meta=(ToolTip="プールが空だったため新規生成した回数"))
+	int32 Misses = 0;
+	UPROPERTY(BlueprintReadOnly, meta=(ToolTip="プール上限超過・親マテリアル不一致で破棄した回数"))
+	int32 Evictions = 0;
+};
+
+/**
+ * EffectID 単位で再利用待ちの MaterialInstanceDynamic を保持するプール
+ */
+USTRUCT()
+struct FPostProcessMaterialPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<TObjectPtr<UMaterialInstanceDynamic>> FreeInstances;
+};
+
+/**
+ * @brief UCurveFloat を正規化時間(0‑1)で等間隔サンプリングしたルックアップテーブル。
+ *
+ * 末尾に最終サンプルを複製しておくことで、Evaluate() を分岐なしの線形補間で行う。
+ */
+class LIQUID_API FPostProcessCurveTable
+{
+public:
+	/**
+	 * @brief カーブをサンプリングしてテーブルを構築。
+	 * @param Curve      サンプリング元のカーブ (nullptr の場合は空テーブル)
+	 * @param Resolution サンプル数 (2 以上)
+	 */
+	void Bake(const UCurveFloat* Curve, int32 Resolution);
+	/** @return テーブルが構築済みなら true */
+	bool IsBaked() const {return !Samples.IsEmpty();}
+	/**
+	 * @brief ベイク済みテーブルから値を取得。IsBaked() が true であること。
+	 * @param NormalizedTime 正規化時間 (0‑1 にクランプ済みであること)
+	 */
+	float Evaluate(float NormalizedTime) const
+	{
+		const float Position = NormalizedTime * LastSampleIndex;
+		const int32 Index = static_cast<int32>(Position);
+		return FMath::Lerp(Samples[Index], Samples[Index + 1], Position - static_cast<float>(Index));
+	}
+#if !UE_BUILD_SHIPPING
+	/** @return 元カーブとの最大誤差(絶対値) */
+	float MeasureMaxError(const UCurveFloat* Curve, int32 NumSteps) const;
+	/** @return 元カーブに対する許容誤差 (値域の ErrorToleranceRatio 倍、値域が 1 未満の場合は ErrorToleranceRatio) */
+	static float GetErrorTolerance(const UCurveFloat* Curve);
+	/** ベイク済みカーブと元カーブの許容誤差(値域に対する割合) */
+	static constexpr float ErrorToleranceRatio = 0.01f;
+	/** 誤差の計測でサンプル間を何分割して評価するか (MeasureMaxError の NumSteps = サンプル数 × この値) */
+	static constexpr int32 ErrorStepsPerSample = 4;
+#endif
+private:
+	TArray<float> Samples;
+	float LastSampleIndex = .0f;
+};
+
+/**
+ * @brief 行のマテリアルロード完了時に構築される、行単位のランタイムキャッシュ。
+ */
+struct FTransientPostProcessRowCache
+{
+	/** ControlParameters と同じ並びのベイク済みカーブ */
+	TArray<FPostProcessCurveTable> ParameterCurves;
+	/** NormalizedWeightCurve のベイク済みカーブ */
+	FPostProcessCurveTable WeightCurve;
+	/** ControlParameters と同じ並びで、操作対象のパラメータがマテリアルに存在するかどうか */
+	TBitArray<> ValidParameterMask;
+	/** bUseBakedCurves が有効でベイク済みなら true */
+	bool bBaked = false;
 };
 
 /**
@@ -61,25 +202,32 @@ enum class PostProcessTaskTickResult : uint8
 };
 
 /**
- * @brief 単一のポストプロセスエフェクトを実行・制御する GC 対応タスク。
+ * @brief 単一のポストプロセスエフェクトを実行・制御するタスク。
  *
- * FGCObject を継承し、内部で生成した UMaterialInstanceDynamic を GC 参照で保護する。
+ * UPostProcessCallSubsystem::TransientTasks に値として連続配置される(ムーブのみ可)。
+ * 内部で保持する UMaterialInstanceDynamic は UPostProcessCallSubsystem::AddReferencedObjects 経由で GC から保護する。
  */
-class FTransientPostProcessTask : public FGCObject
+class FTransientPostProcessTask
 {
 public:
 
 	/**
 	 * コンストラクタ
-	 * * @param EffectID DataTable上のID
+	 * @param EffectID DataTable上のID
 	 * @param ConfigPtr 使用する構成情報
 	 * @param Owner 所有者（Subsystem）
+	 * @param TargetCamera 適用先のカメラ (未設定の場合はプレイヤー 0 のカメラ)
+	 * @param RowCache 行のランタイムキャッシュ (ベイク済みカーブ等、nullptr 可)
 	 */	
-	explicit FTransientPostProcessTask(const FName& EffectID, const FTransientPostProcessConfig* ConfigPtr, UPostProcessCallSubsystem* Owner);
-	/** GC参照の識別子名 */
-	virtual FString GetReferencerName() const override;
+	explicit FTransientPostProcessTask(const FName& EffectID, const FTransientPostProcessConfig* ConfigPtr, UPostProcessCallSubsystem* Owner,
+		const TWeakObjectPtr<APlayerCameraManager>& TargetCamera = nullptr, TSharedPtr<const FTransientPostProcessRowCache> RowCache = nullptr);
+	FTransientPostProcessTask(FTransientPostProcessTask&&) = default;
+	FTransientPostProcessTask& operator=(FTransientPostProcessTask&&) = default;
+	FTransientPostProcessTask(const FTransientPostProcessTask&) = delete;
+	FTransientPostProcessTask& operator=(const FTransientPostProcessTask&) = delete;
+
 	/** GC参照対象を追加 */
-	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	void AddReferencedObjects(FReferenceCollector& Collector);
 	/**
 	 * @brief タスクを初期化して有効化。
 	 * @param OwnerMaterial 事前ロード済みのベースマテリアル
@@ -89,34 +237,51 @@ public:
 	/**
 	 * @brief 初期化用ラムダを受け取りつつタスクを有効化。
 	 * @param OwnerMaterial ベースマテリアル
-	 * @param InitFunction  M.I.D. に対し初期値を設定するユーザコールバック
+	 * @param InitFunction  M.I.D. に対し初期値を設定するユーザコールバック (カーブで制御するパラメータはカーブの値が優先される)
 	 * @return 成功した場合 true
 	 */
 	bool Activate(UMaterialInstance* OwnerMaterial, const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction);
 	/**
-	 * @brief 1フレーム分更新し、ポストプロセスをカメラに反映する。
-	 * @param CameraManager 対象の APlayerCameraManager
+	 * @brief 1フレーム分更新し、現在の Weight を設定した MID を Blendable として追加する。
+	 * @param OutBlendables カメラへまとめて適用する Blendable リスト
 	 * @param DeltaTime     経過時間[秒]
 	 * @return 進行状態 (Progress / Finish)
+	 * ※Finish を返したフレームも MID は描画に使用されるため、Cleanup は呼び出し側が次フレーム以降に行う
 	 */
-	PostProcessTaskTickResult Tick(APlayerCameraManager* CameraManager, float DeltaTime);
+	PostProcessTaskTickResult Tick(FWeightedBlendables& OutBlendables, float DeltaTime);
 	/** @return データテーブル上の EffectID */
 	const FName& GetEffectID() const{return EffectID;}
 	/** @return タスクに紐付く構成情報 */
 	const FTransientPostProcessConfig* GetConfig() const{return PostProcessConfig;}
+	/** @return 適用順序のプライオリティ */
+	int32 GetPriority() const{return PostProcessConfig->Priority;}
+	/** @return 再生開始からの経過時間[秒] */
+	float GetElapsedTime() const{return ElapsedTime;}
+	/** @return 適用先のカメラ ※未設定(IsExplicitlyNull)の場合はプレイヤー 0 のカメラに適用する */
+	const TWeakObjectPtr<APlayerCameraManager>& GetTargetCamera() const{return TargetCamera;}
+	/**
+	 * @brief 経過時間を 0 に戻して最初から再生し直す。MID はそのまま使い回す。
+	 * @param InitFunction M.I.D. に対し初期値を設定するユーザコールバック
+	 */
+	void Restart();
+	void Restart(const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction);
 	/**
 	 * @brief フレーム終了時にタスク削除予定かどうかを判定。
 	 * @param CurrentFrameDeltaTime 本フレームの DeltaTime
 	 */
 	bool IsScheduleDeleteTask(float CurrentFrameDeltaTime) const;
 
+	/** 終了処理 (MID のプール返却など) */
+	void Cleanup();
+
 private:
-	/** MID を生成 */
+	/** MID をプールから取得(空の場合は生成) */
 	bool CreateMaterialInstanceDynamic(UMaterialInstance* OwnerMaterial);
-	/** 終了処理 (MID の GC など) */
-	void Cleanup();
-	/** WeightedBlendables を初期化 */
-	void InitializeOverrideSettings();
+	/** ControlParameters を MID のパラメータインデックスへ解決 */
+	void ResolveScalarParameters();
+	/** カーブに従って MID のスカラーを更新し、現在の Weight を返す */
+	float EvaluateCurves(float NormalizedElapsedTime);
+	float EvaluateBakedCurves(float NormalizedElapsedTime);
 private:
 	// --------------------------------------------------------------------
 	//  外部所有参照 – ライフタイム保証は UPostProcessCallSubsystem が担う
@@ -124,14 +289,65 @@ private:
 	//note: このふたつのポインタはUPostProcessCallSubsystemよりもこのクラスのライフサイクルが短いことと、DatatableをUPROPERTYで保持しているため生ポインタで保持している
 	const FTransientPostProcessConfig* PostProcessConfig{nullptr};
 	UPostProcessCallSubsystem* Owner{};
+	//note: テーブル再構築時にも再生中のタスクが参照を保持できるよう共有ポインタで保持
+	TSharedPtr<const FTransientPostProcessRowCache> RowCache{};
 
-	//note: このオブジェクトをGCオブジェクトとして保護
+	//note: UPostProcessCallSubsystem::AddReferencedObjects で GC から保護される
 	TObjectPtr<UMaterialInstanceDynamic> MaterialInstanceDynamic{nullptr};
-	FPostProcessSettings OverrideSettings{};
+	TWeakObjectPtr<APlayerCameraManager> TargetCamera{};
 	FName EffectID{}; //DataTable上のID
 	float ElapsedTime = .0f; //秒
+	//note: ControlParameters と同じ並びの MID 上のスカラーパラメータインデックス。INDEX_NONE は更新対象外
+	TArray<int32, TInlineAllocator<8>> ScalarParameterIndices;
 };
 
+/**
+ * @brief 同一 Priority の行のマテリアルをまとめて非同期ロードする単位。
+ */
+struct FPostProcessMaterialLoadBatch
+{
+	TArray<FName> EffectIDs;
+	int32 Priority = 0;
+	TSharedPtr<FStreamableHandle> Handle{};
+};
+
+/**
+ * @brief マテリアルのロード完了を待っている再生要求。
+ */
+struct FPendingTransientPostProcessPlay
+{
+	FName EffectID{};
+	/** 適用先のカメラ ※未設定の場合はプレイヤー 0 のカメラ */
+	TWeakObjectPtr<APlayerCameraManager> TargetCamera{};
+};
+
+/**
+ * @brief 同じカメラに適用するタスクの Blendable をまとめて 1 回で適用するためのグループ。
+ */
+struct FTransientPostProcessCameraGroup
+{
+	TWeakObjectPtr<APlayerCameraManager> CameraManager{};
+	/** グループ内の Blendable をまとめた設定 ※フレーム間で使い回す */
+	FPostProcessSettings Settings{};
+};
+
+/**
+ * ポストプロセス構成情報のデータテーブル設定 (UPostProcessCallSubsystem::PostProcessTables)
+ */
+USTRUCT()
+struct FTransientPostProcessTableEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, meta=(RequiredAssetDataTags="RowStructure=/Script/liquid.TransientPostProcessConfig", ToolTip="FTransientPostProcessConfigを行とするデータテーブル"))
+	TSoftObjectPtr<UDataTable> Table{};
+
+	UPROPERTY(EditAnywhere, meta=(ToolTip="このテーブルを使用するマップ(空の場合は全てのマップで使用)"))
+	TArray<TSoftObjectPtr<UWorld>> Maps{};
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnTransientPostProcessReady);
+
 /**
  * データテーブルに基づいてポストプロセスエフェクトを適用するWorld Subsystem
  */
@@ -143,6 +359,9 @@ public:
 	
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
 	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	/** TransientTasks が保持する MID を GC から保護する */
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
 
 	/**
 	 * @brief データテーブル ID を指定してエフェクトを再生。
@@ -157,6 +376,20 @@ public:
 	 * @param InitFunction MID への初期設定コールバック
 	 */
 	bool PlayTransientPostProcess(const FName& EffectID, const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction);
+	/**
+	 * @brief 指定したカメラに対してエフェクトを再生。(分割画面・観戦カメラ用)
+	 * @param EffectID      行ID
+	 * @param CameraManager 適用先のカメラ (nullptr の場合はプレイヤー 0 のカメラ)
+	 */
+	bool PlayTransientPostProcess(const FName& EffectID, APlayerCameraManager* CameraManager);
+	bool PlayTransientPostProcess(const FName& EffectID, APlayerCameraManager* CameraManager, const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction);
+	/**
+	 * @brief 指定したローカルプレイヤーのカメラに対してエフェクトを再生。
+	 * @param EffectID    行ID
+	 * @param PlayerIndex ローカルプレイヤーのインデックス
+	 */
+	UFUNCTION(BlueprintCallable,Category="PostProcess", meta=(ToolTip="指定したローカルプレイヤーのカメラにデータテーブル上のIDに基づいてポストエフェクトを呼び出します"))
+	bool PlayTransientPostProcessForPlayer(const FName& EffectID, int32 PlayerIndex);
 	/**
 	 * @brief 指定 ID のエフェクトが再生中かチェック。
 	 * @param EffectID 行ID
@@ -164,34 +397,226 @@ public:
 	 * @return 再生中なら true
 	 */
 	bool IsPlayingTransientPostProcess(const FName& EffectID, const UWorld* InWorld) const;
+
+	/**
+	 * @brief EffectID に対応するプールから MID を取得。プールが空の場合は新規生成する。
+	 * @param EffectID       行ID
+	 * @param ParentMaterial 親に設定するマテリアル
+	 * @return 親設定済み・パラメータ初期化済みの MID (失敗時 nullptr)
+	 */
+	UMaterialInstanceDynamic* AcquireMaterialInstanceDynamic(const FName& EffectID, UMaterialInstance* ParentMaterial);
+	/**
+	 * @brief 使用済み MID をパラメータをリセットしたうえでプールへ返却。
+	 * @param EffectID         行ID
+	 * @param Config           行の構成情報(プール上限の参照に使用)
+	 * @param MaterialInstance 返却する MID
+	 */
+	void ReleaseMaterialInstanceDynamic(const FName& EffectID, const FTransientPostProcessConfig& Config, UMaterialInstanceDynamic* MaterialInstance);
+
+	/**
+	 * @brief LoadPolicy が PreloadByTag で PreloadTag が一致する行のマテリアルをロード。
+	 * @param Tag 行の PreloadTag
+	 */
+	UFUNCTION(BlueprintCallable, Category="PostProcess", meta=(ToolTip="PreloadTagが一致するポストプロセスマテリアルを事前ロードします"))
+	void PreloadTransientPostProcessByTag(FName Tag);
+
+	/** @return 初期化時にロードする(Eager)全行のマテリアルロードが完了していれば true */
+	UFUNCTION(BlueprintPure, Category="PostProcess", meta=(ToolTip="初期化時にロードするポストプロセスマテリアルのロードが完了しているかどうか"))
+	bool IsTransientPostProcessReady() const {return bMaterialsReady;}
+	/** @return Initialize から Ready になるまでの時間[秒] (未完了の場合は負値) */
+	float GetTimeToReadySeconds() const {return TimeToReadySeconds;}
+	/** @return Initialize のゲームスレッド処理時間[秒] */
+	float GetInitializeSeconds() const {return InitializeSeconds;}
+	/** @return Initialize からテーブルのロード完了までの時間[秒] */
+	float GetTableLoadSeconds() const {return TableLoadSeconds;}
+
+	/** 全てのポストプロセスマテリアルのロードが完了した時に呼ばれる */
+	UPROPERTY(BlueprintAssignable, Category="PostProcess")
+	FOnTransientPostProcessReady OnTransientPostProcessReady;
+
+	/**
+	 * @brief ロード済みエフェクトの依存アセット(マテリアル・テクスチャ・カーブ)の情報を取得。
+	 * @return 未ロードの場合 nullptr
+	 */
+	const FLiquidEffectBundle* FindEffectBundle(const FName& EffectID) const {return EffectBundles.Find(EffectID);}
+	const TMap<FName, FLiquidEffectBundle>& GetEffectBundles() const {return EffectBundles;}
+	/** @return ロード済みエフェクトの依存アセットのメモリ使用量の見積もり[Byte] (未ロードの場合 0) */
+	UFUNCTION(BlueprintPure, Category="PostProcess", meta=(ToolTip="ロード済みポストプロセスの依存アセット(マテリアル・テクスチャ・カーブ)のメモリ使用量の見積もり[Byte]を取得します"))
+	int64 GetEffectBundleFootprintBytes(FName EffectID) const;
+
+	/**
+	 * @brief PostProcessTables に設定された全てのテーブルのパスを収集。(マップの指定は無視する)
+	 * @details サブシステムの生成前にテーブルを参照する場合用。(PSO のウォームアップ等)
+	 */
+	static void GatherConfiguredPostProcessTablePaths(TArray<FSoftObjectPath>& OutTablePaths);
+
+	/** @return MID プールの統計情報 */
+	UFUNCTION(BlueprintPure, Category="PostProcess", meta=(ToolTip="MaterialInstanceDynamicプールのヒット・ミス・破棄回数を取得します"))
+	FPostProcessMaterialPoolStats GetMaterialPoolStats() const {return MaterialPoolStats;}
 	
 private:
+	friend struct FPostProcessTaskBenchmark;
+
 	/** エフェクトの適用開始 */
-	bool BeginTransientPostProcess(const FName& EffectID, const FTransientPostProcessConfig* Config);
-	bool BeginTransientPostProcess(const FName& EffectID, const FTransientPostProcessConfig* Config, const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction);
+	bool BeginTransientPostProcess(const FName& EffectID, const FTransientPostProcessConfig* Config, const TWeakObjectPtr<APlayerCameraManager>& TargetCamera = nullptr);
+	bool BeginTransientPostProcess(const FName& EffectID, const FTransientPostProcessConfig* Config, const TWeakObjectPtr<APlayerCameraManager>& TargetCamera,
+		const TFunctionRef<void(UMaterialInstanceDynamic*)>& InitFunction);
+	/** 有効化済みのタスクを同一 Priority 内の追加順を保ったまま Priority の昇順位置へ挿入 */
+	void InsertTransientTask(FTransientPostProcessTask&& Task);
+	/** 全タスクを終了して破棄 */
+	void ClearTransientTasks();
+	/** 終了したタスクを MID が描画に使用されなくなるまで保持する (Cleanup は次の TickTransientTasks の先頭で行う) */
+	void RetireTransientTask(FTransientPostProcessTask&& Task);
+	/** 保持している終了済みタスクを Cleanup して MID をプールへ返却 */
+	void ReleaseRetiredTasks();
+	/**
+	 * @brief 同時実行数の上限を超える場合に OverflowPolicy に従って空きを作る。
+	 * @param TargetCamera    新しいタスクの適用先のカメラ
+	 * @param OutRestartIndex RestartSameEffect で再始動するタスクのインデックス (新規追加の場合 INDEX_NONE)
+	 * @return 新規追加または再始動できる場合 true。再生要求を破棄する場合 false
+	 */
+	bool MakeRoomForTransientTask(const FName& EffectID, const FTransientPostProcessConfig& Config,
+		const TWeakObjectPtr<APlayerCameraManager>& TargetCamera, int32& OutRestartIndex);
+	/** @return RetriggerCooldown 中の場合 true (再生時刻の記録は再生を受け付けた後に RecordRetrigger で行う) */
+	bool IsInRetriggerCooldown(const FName& EffectID, const FTransientPostProcessConfig& Config) const;
+	/** @brief RetriggerCooldown の起点となる再生時刻を記録する */
+	void RecordRetrigger(const FName& EffectID, const FTransientPostProcessConfig& Config);
+	/** @return 上限判定の対象タスクのうち、Priority が最も低いもの(同一 Priority では先に追加されたもの)のインデックス */
+	int32 FindLowestPriorityTask(const FName* EffectIDFilter) const;
+	/** @return 上限判定の対象タスクのうち、経過時間が最も長いもののインデックス */
+	int32 FindOldestTask(const FName* EffectIDFilter) const;
 	
 	/** WorldのPostTick時に呼び出されるタスク更新関数 */
 	void OnWorldPostActorTick(UWorld* InWorld, ELevelTick InType,float DeltaTime);
+	/**
+	 * @brief 全タスクを Priority の昇順に更新し、終了したタスクを順序を保ったまま取り除く。
+	 * Blendable はカメラ毎にまとめ、カメラ毎に 1 回だけ適用する。
+	 * @param DeltaTime 経過時間[秒]
+	 */
+	void TickTransientTasks(float DeltaTime);
+	/** @return CameraGroups のうち指定カメラのグループのインデックス (存在しない場合は追加) */
+	int32 FindOrAddCameraGroup(APlayerCameraManager* CameraManager);
+	/** @return ローカルプレイヤーのカメラ (キャッシュが無効な場合のみ再検索する) */
+	APlayerCameraManager* GetCameraManagerForPlayer(int32 PlayerIndex);
+	void RebuildCameraManagerCache();
+	void OnLocalPlayersChanged(ULocalPlayer* LocalPlayer);
+	void OnGameModePostLogin(AGameModeBase* GameMode, APlayerController* NewPlayer);
+	void OnGameModeLogout(AGameModeBase* GameMode, AController* Exiting);
 	UMaterialInstance* GetLoadedMaterial(const FName& EffectID) const;
+	/** @return マージ済みテーブルの行 (存在しない場合 nullptr) */
+	const FTransientPostProcessConfig* FindConfig(const FName& EffectID) const;
 
-	void LoadPostProcessMaterialAsync(const FName& EffectID);
+	void GatherPostProcessTablePaths(TArray<FSoftObjectPath>& OutTablePaths) const;
+	void OnPostProcessTablesLoaded();
+
+	/**
+	 * @brief 行のマテリアルのロードを要求。
+	 * @return ロード中(今回の要求を含む)なら true。ロード済み・リトライ上限到達の場合は false
+	 */
+	bool RequestMaterialLoad(const FName& EffectID, const FTransientPostProcessConfig& Config);
+	void PumpMaterialLoadBatches();
+	void OnMaterialLoadBatchCompleted(int32 BatchID);
+	void OnPostProcessMaterialLoaded(const FName& EffectID, const FTransientPostProcessConfig& Config, UMaterialInstance* LoadedMaterial);
+	/** Eager 以外の行で UnusedMaterialReleaseSeconds 以上使われていないマテリアルを解放 */
+	void ReleaseUnusedMaterials(double CurrentTime);
+	/** PoolWarmupCount に従って MID を事前生成 */
+	void WarmupMaterialPool(const FName& EffectID, const FTransientPostProcessConfig& Config, UMaterialInstance* ParentMaterial);
+	/** 行の依存アセット(マテリアル・テクスチャ・カーブ)を収集し、bPreloadTextureMips の場合はテクスチャの全Mipを要求 */
+	void BuildEffectBundle(const FName& EffectID, const FTransientPostProcessConfig& Config, UMaterialInstance* Material);
+	/** bPreloadTextureMips の行の再生時に、再生時間の間テクスチャの全Mipを常駐させる */
+	void RequestEffectTextureMips(const FName& EffectID, const FTransientPostProcessConfig& Config) const;
+	void UpdateEffectBundleMemoryStat() const;
+	/** 行のランタイムキャッシュ(ベイク済みカーブ・パラメータ検証結果等)を構築 */
+	void BuildRowCache(const FName& EffectID, const FTransientPostProcessConfig& Config, const UMaterialInstance* Material);
+	TSharedPtr<const FTransientPostProcessRowCache> FindRowCache(const FName& EffectID) const;
+	/** MID をプールから外して破棄 */
+	void EvictMaterialInstanceDynamic(UMaterialInstanceDynamic* MaterialInstance);
 	static float GetEffectiveDeltaSeconds(const UWorld* InWorld);
 private:
 	
-	/** ポストプロセス設定を格納したデータテーブル ※アセットのパスはTableAssetPathでハードコーディングされています*/
+	/**
+	 * ポストプロセス設定を格納したデータテーブルのリスト (DefaultGame.ini で設定)
+	 * 行名でマージし、同名の行はリストの後ろのテーブルで上書きする (例: コア → マップ別 → DLC)
+	 */
+	UPROPERTY(Config)
+	TArray<FTransientPostProcessTableEntry> PostProcessTables;
+
+	/** ロード済みのデータテーブル ※MergedRows の行データを保護する */
 	UPROPERTY()
-	TObjectPtr<UDataTable> PostProcessTable{nullptr};
+	TArray<TObjectPtr<UDataTable>> PostProcessTableAssets;
+	//note: 行データは PostProcessTableAssets が保持しているため生ポインタで保持している
+	TMap<FName, const FTransientPostProcessConfig*> MergedRows;
+	TSharedPtr<FStreamableHandle> TableLoadingHandle{};
+	bool bTablesLoaded = false;
 
 	UPROPERTY()
 	TMap<FName, TObjectPtr<UMaterialInstance>> CachedMaterials;
-	TArray<TUniquePtr<FTransientPostProcessTask>> TransientTasks;
+	/** 実行中のタスク ※Priority の昇順(同一 Priority は追加順)に並んでいる */
+	TArray<FTransientPostProcessTask> TransientTasks;
+	/** 終了したが、MID がまだ描画に使用されている可能性のあるタスク */
+	TArray<FTransientPostProcessTask> RetiredTasks;
+
+	/** カメラ毎に Blendable をまとめて適用するためのグループ ※フレーム間で使い回す */
+	TArray<FTransientPostProcessCameraGroup> CameraGroups{};
+	/** ローカルプレイヤーのインデックス順のカメラ */
+	TArray<TWeakObjectPtr<APlayerCameraManager>> CachedCameraManagers{};
+	/** プレイヤーの追加・削除時に立て、次のカメラ取得時にキャッシュを再構築する */
+	bool bCameraManagersDirty = true;
+	FDelegateHandle LocalPlayerAddedHandle;
+	FDelegateHandle LocalPlayerRemovedHandle;
+	FDelegateHandle PostLoginHandle;
+	FDelegateHandle LogoutHandle;
+
+	/** EffectID 毎の再利用待ち MID */
+	UPROPERTY()
+	TMap<FName, FPostProcessMaterialPool> MaterialPools;
+	FPostProcessMaterialPoolStats MaterialPoolStats{};
+
+	/** EffectID 毎の依存アセット */
+	TMap<FName, FLiquidEffectBundle> EffectBundles;
+	/** ロード完了時にテクスチャの全Mipを常駐させる時間[秒] (bPreloadTextureMips の行のみ) */
+	UPROPERTY(Config)
+	float TextureMipPreloadSeconds = 30.0f;
+
+	/** EffectID 毎のランタイムキャッシュ */
+	TMap<FName, TSharedPtr<const FTransientPostProcessRowCache>> RowCaches;
 	
 	FDelegateHandle PostActorTickHandle;
 	
-	TQueue<FName> LoadMaterialQueue{};
-	TSharedPtr<FStreamableHandle> CurrentLoadingHandle{};
-	static constexpr TCHAR TableAssetPath[] = TEXT("/liquid/post_process/sample_table");
-	static constexpr int32 TransientPostProcessCapacity = 16;
+	/** 未発行のロードバッチ (Priority の降順) */
+	TArray<FPostProcessMaterialLoadBatch> PendingLoadBatches{};
+	/** ロード中のバッチ */
+	TMap<int32, FPostProcessMaterialLoadBatch> InFlightLoadBatches{};
+	int32 NextLoadBatchID = 0;
+	/** ロード要求済み(リトライ待ち含む)の行 */
+	TSet<FName> LoadingEffectIDs{};
+	/** マテリアルのロード完了を待って再生する要求 */
+	TArray<FPendingTransientPostProcessPlay> PendingPlays{};
+	/** 行毎のマテリアル最終使用時刻(World の RealTimeSeconds) */
+	TMap<FName, double> MaterialLastUsedTimes{};
+	double LastReleaseCheckTime = .0;
+	/** Eager 以外の行のマテリアルを解放するまでの未使用時間[秒] (0 以下で解放しない) */
+	UPROPERTY(Config)
+	float UnusedMaterialReleaseSeconds = 60.0f;
+	static constexpr double MaterialReleaseCheckInterval = 1.0;
+	/** 同時に発行するロードリクエストの最大数 */
+	UPROPERTY(Config)
+	int32 MaxConcurrentMaterialLoads = 4;
+
+	double InitializeStartTime = .0;
+	float InitializeSeconds = .0f;
+	float TableLoadSeconds = -1.0f;
+	float TimeToReadySeconds = -1.0f;
+	bool bMaterialsReady = false;
+
+	/** 同時に実行するタスクの最大数 (マテリアルのロード待ちの再生要求もこの数までに制限する) */
+	UPROPERTY(Config)
+	int32 MaxTransientTasks = 16;
+	/** MaxTransientTasks・MaxConcurrentInstances に達した時の動作 */
+	UPROPERTY(Config)
+	ETransientPostProcessOverflowPolicy OverflowPolicy = ETransientPostProcessOverflowPolicy::EvictLowestPriority;
+	/** RetriggerCooldown が設定された行の最終再生時刻(World の TimeSeconds) */
+	TMap<FName, double> LastTriggerTimes{};
 	
 	TMap<FName, int32> LoadRetryCounts;
 	static constexpr int32 MaxLoadRetryCount = 8;
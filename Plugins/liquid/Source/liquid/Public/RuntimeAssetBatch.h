@@ -0,0 +1,306 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
+#include "RuntimeAssetPtr.h"
+
+/**
+ * TRuntimeAssetBatch
+ *
+ *  - 複数の SoftObjectPtr をまとめて1つの FStreamableHandle で非同期ロードするヘルパークラス
+ *  - 各要素は TRuntimeAssetPtr として保持し、ロード後は Get(Index) で即利用
+ *  - 要素毎のロード完了コールバック(ロードされた順)と、全要素終了時のコールバックを持つ
+ *  - ロードに失敗した要素は MaxRetryCount 回まで、失敗した要素だけをまとめて再要求する
+ *  - このオブジェクト自身はロードしたAssetのGC保護をしないので注意 (TRuntimeAssetPtr と同じ)
+ *  - コールバックは世代番号で検証し、Cancel() / 破棄後に遅れて届いたものは何もしない
+ */
+template<typename AssetType>
+class TRuntimeAssetBatch
+{
+	static_assert(TIsDerivedFrom<AssetType, UObject>::IsDerived, "AssetType must derive from UObject");
+public:
+	using ThisType = TRuntimeAssetBatch<AssetType>;
+	/** @param Index 要素の Index @param Asset ロードしたアセット(リトライを含めて失敗した場合は nullptr) */
+	using FOnItemLoaded = TFunction<void(int32 Index, AssetType* Asset)>;
+	/** @param NumLoaded ロードに成功した要素数 @param NumFailed 失敗した要素数 */
+	using FOnAllLoaded = TFunction<void(int32 NumLoaded, int32 NumFailed)>;
+
+	TRuntimeAssetBatch() =default;
+	explicit TRuntimeAssetBatch(const TArray<TSoftObjectPtr<AssetType>>& SoftPtrs) { SetSoftPtrs(SoftPtrs); }
+	~TRuntimeAssetBatch() { Cancel(); }
+	TRuntimeAssetBatch(const ThisType&) = delete;
+	ThisType& operator=(const ThisType&) = delete;
+
+	void SetSoftPtrs(const TArray<TSoftObjectPtr<AssetType>>& SoftPtrs)
+	{
+		Cancel();
+		Items.Reset(SoftPtrs.Num());
+		States.Reset(SoftPtrs.Num());
+		RetryCounts.Reset(SoftPtrs.Num());
+		for (const TSoftObjectPtr<AssetType>& SoftPtr : SoftPtrs)
+		{
+			Items.Emplace(SoftPtr);
+			States.Add(SoftPtr.IsNull() ? EItemState::Failed : EItemState::Pending);
+			RetryCounts.Add(0);
+		}
+	}
+
+	/**
+	 * @brief 未ロードの全要素をまとめて非同期ロードする。
+	 * @param ItemCallback 要素毎のロード完了コールバック
+	 * @param AllCallback 全要素のロード(失敗を含む)終了時のコールバック
+	 * @param InMaxRetryCount ロードに失敗した要素を再要求する最大回数
+	 * @param Priority FStreamableManager のロード優先度
+	 * @details ロード済みの要素はこの関数内でコールバックを呼ぶ。
+	 */
+	void LoadAsync(FOnItemLoaded ItemCallback = nullptr, FOnAllLoaded AllCallback = nullptr,
+				   int32 InMaxRetryCount = 2, int32 Priority = FStreamableManager::DefaultAsyncLoadPriority)
+	{
+		if (IsLoading())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("[TRuntimeAssetBatch] LoadAsync called again during LoadAsync. Num: %d"), Items.Num());
+			return;
+		}
+		ItemLoadedCallback = MoveTemp(ItemCallback);
+		AllLoadedCallback = MoveTemp(AllCallback);
+		MaxRetryCount = FMath::Max(InMaxRetryCount, 0);
+		LoadPriority = Priority;
+		for (int32& RetryCount : RetryCounts)
+		{
+			RetryCount = 0;
+		}
+		RequestPendingItems();
+	}
+
+	/**
+	 * @brief ロード中の要求をキャンセルする。コールバックは呼ばれない。(ロード済みの要素はそのまま)
+	 */
+	void Cancel()
+	{
+		//CancelHandle()でCallbackが呼ばれることがあるので先に無効化しておく
+		++*Generation;
+		ItemLoadedCallback = nullptr;
+		AllLoadedCallback = nullptr;
+		RequestedIndices.Reset();
+		if (LoadingHandle.IsValid())
+		{
+			LoadingHandle->CancelHandle();
+		}
+		LoadingHandle.Reset();
+	}
+
+	int32 Num() const { return Items.Num(); }
+	int32 NumLoaded() const { return CountState(EItemState::Loaded); }
+	int32 NumFailed() const { return CountState(EItemState::Failed); }
+	bool IsLoading() const { return LoadingHandle.IsValid(); }
+	bool IsComplete() const { return !IsLoading() && CountState(EItemState::Pending) == 0; }
+
+	/**
+	 * @return 0～1 のロード進捗。(失敗した要素も終了として数える)
+	 */
+	float GetProgress() const
+	{
+		if (Items.IsEmpty())
+		{
+			return 1.0f;
+		}
+		float Done = static_cast<float>(Items.Num() - CountState(EItemState::Pending));
+		if (LoadingHandle.IsValid())
+		{
+			//要求中の要素のうち、まだ通知していない分の進捗
+			int32 NumNotified = 0;
+			for (const int32 Index : RequestedIndices)
+			{
+				NumNotified += States[Index] != EItemState::Pending ? 1 : 0;
+			}
+			Done += LoadingHandle->GetProgress() * (RequestedIndices.Num() - NumNotified);
+		}
+		return FMath::Clamp(Done / Items.Num(), .0f, 1.0f);
+	}
+
+	AssetType* Get(int32 Index) const
+	{
+		return Items.IsValidIndex(Index) ? Items[Index].Get() : nullptr;
+	}
+	bool IsLoaded(int32 Index) const
+	{
+		return States.IsValidIndex(Index) && States[Index] == EItemState::Loaded;
+	}
+	bool IsFailed(int32 Index) const
+	{
+		return States.IsValidIndex(Index) && States[Index] == EItemState::Failed;
+	}
+
+private:
+	enum class EItemState : uint8
+	{
+		Pending,
+		Loaded,
+		Failed,
+	};
+
+	int32 CountState(EItemState State) const
+	{
+		int32 Count = 0;
+		for (const EItemState ItemState : States)
+		{
+			Count += ItemState == State ? 1 : 0;
+		}
+		return Count;
+	}
+
+	/**
+	 * @return コールバック発行時から Cancel() / 破棄されていなければ true
+	 */
+	static bool IsCurrentGeneration(const TWeakPtr<uint32>& WeakGeneration, uint32 CurrentGeneration)
+	{
+		const TSharedPtr<uint32> Pinned = WeakGeneration.Pin();
+		return Pinned.IsValid() && *Pinned == CurrentGeneration;
+	}
+
+	/**
+	 * @brief Pending の要素をまとめて1つのリクエストで要求する。無ければ全体の完了を通知する。
+	 */
+	void RequestPendingItems()
+	{
+		RequestedIndices.Reset();
+		TArray<FSoftObjectPath> Paths;
+		for (int32 Index = 0; Index < Items.Num(); ++Index)
+		{
+			if (States[Index] != EItemState::Pending)
+			{
+				continue;
+			}
+			//ロード済みのアセットは要求しない
+			if (Items[Index].TryGetNow())
+			{
+				NotifyItem(Index, EItemState::Loaded);
+				continue;
+			}
+			RequestedIndices.Add(Index);
+			Paths.Add(Items[Index].GetSoftPtr().ToSoftObjectPath());
+		}
+		if (Paths.IsEmpty())
+		{
+			NotifyAllLoaded();
+			return;
+		}
+
+		FStreamableManager& Manager = UAssetManager::GetStreamableManager();
+		TSharedPtr<FStreamableHandle> Handle = Manager.RequestAsyncLoad(
+			MoveTemp(Paths),
+			FStreamableDelegate::CreateLambda([this, WeakGeneration = TWeakPtr<uint32>(Generation), CurrentGeneration = *Generation]()
+			{
+				if (IsCurrentGeneration(WeakGeneration, CurrentGeneration))
+				{
+					this->OnRequestCompleted();
+				}
+			}),
+			LoadPriority);
+		if (!Handle.IsValid())
+		{
+			//リクエスト自体が発行できなかった場合はリトライ回数を消費して結果を確定させる
+			OnRequestCompleted();
+			return;
+		}
+		//ロード済みだった場合は RequestAsyncLoad 内で完了している
+		if (Handle->HasLoadCompleted())
+		{
+			return;
+		}
+		LoadingHandle = Handle;
+		LoadingHandle->BindUpdateDelegate(FStreamableUpdateDelegate::CreateLambda(
+			[this, WeakGeneration = TWeakPtr<uint32>(Generation), CurrentGeneration = *Generation](TSharedRef<FStreamableHandle>)
+			{
+				if (IsCurrentGeneration(WeakGeneration, CurrentGeneration))
+				{
+					this->OnRequestUpdated();
+				}
+			}));
+	}
+
+	/**
+	 * @brief リクエストの途中経過。ロードが終わった要素から順に通知する。
+	 */
+	void OnRequestUpdated()
+	{
+		for (const int32 Index : RequestedIndices)
+		{
+			if (States[Index] == EItemState::Pending && Items[Index].TryGetNow())
+			{
+				NotifyItem(Index, EItemState::Loaded);
+			}
+		}
+	}
+
+	void OnRequestCompleted()
+	{
+		LoadingHandle.Reset();
+		const TArray<int32> Indices = MoveTemp(RequestedIndices);
+		bool bRetry = false;
+		for (const int32 Index : Indices)
+		{
+			if (States[Index] != EItemState::Pending)
+			{
+				continue;
+			}
+			if (Items[Index].TryGetNow())
+			{
+				NotifyItem(Index, EItemState::Loaded);
+				continue;
+			}
+			const FString Path = Items[Index].GetSoftPtr().ToString();
+			if (RetryCounts[Index]++ < MaxRetryCount)
+			{
+				UE_LOG(LogTemp, Warning,
+					TEXT("[TRuntimeAssetBatch] Retry %d / %d : %s"), RetryCounts[Index], MaxRetryCount, *Path);
+				bRetry = true;
+				continue;
+			}
+			UE_LOG(LogTemp, Error, TEXT("[TRuntimeAssetBatch] Failed to load asset: %s"), *Path);
+			NotifyItem(Index, EItemState::Failed);
+		}
+		if (bRetry)
+		{
+			RequestPendingItems();
+			return;
+		}
+		NotifyAllLoaded();
+	}
+
+	void NotifyItem(int32 Index, EItemState NewState)
+	{
+		States[Index] = NewState;
+		if (ItemLoadedCallback)
+		{
+			ItemLoadedCallback(Index, NewState == EItemState::Loaded ? Items[Index].Get() : nullptr);
+		}
+	}
+
+	void NotifyAllLoaded()
+	{
+		//コールバック内で再度 LoadAsync されても良いように取り出してから呼ぶ
+		FOnAllLoaded Callback = MoveTemp(AllLoadedCallback);
+		AllLoadedCallback = nullptr;
+		ItemLoadedCallback = nullptr;
+		if (Callback)
+		{
+			Callback(NumLoaded(), NumFailed());
+		}
+	}
+
+private:
+	TArray<TRuntimeAssetPtr<AssetType>> Items{};
+	TArray<EItemState> States{};
+	TArray<int32> RetryCounts{};
+	TArray<int32> RequestedIndices{}; // 現在のリクエストに含まれている要素
+	TSharedPtr<FStreamableHandle> LoadingHandle{};
+	TSharedRef<uint32> Generation = MakeShared<uint32>(0); // Cancel() 毎に進める。コールバックは弱参照で検証する
+	FOnItemLoaded ItemLoadedCallback{nullptr};
+	FOnAllLoaded AllLoadedCallback{nullptr};
+	int32 MaxRetryCount = 2;
+	int32 LoadPriority = FStreamableManager::DefaultAsyncLoadPriority;
+};
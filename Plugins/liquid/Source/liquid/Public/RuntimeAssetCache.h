@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Engine/StreamableManager.h"
+
+/**
+ * FRuntimeAssetCache
+ *
+ *  - FSoftObjectPath をキーにした参照カウント付きの共有アセットキャッシュ
+ *  - 同じパスへのロード要求は1つの FStreamableHandle にまとめ、完了時に待機中の全てのコールバックを呼ぶ
+ *  - 参照カウントが 1 以上の間は FStreamableHandle を保持するのでアセットは GC されない
+ *  - 最後の Release 後もすぐには解放せず、猶予時間 (liquid.AssetCache.GracePeriod) の間は LRU に残す
+ *    猶予中に再度 Acquire された場合は再ロードなしで即座に返す
+ *  - ゲームスレッド専用
+ */
+class LIQUID_API FRuntimeAssetCache
+{
+public:
+	using FOnAssetLoaded = TFunction<void(UObject*)>;
+
+	static FRuntimeAssetCache& Get();
+
+	/**
+	 * @brief アセットの参照カウントを1つ増やし、未ロードであれば非同期ロードを開始する。
+	 * @param Path ロードするアセット
+	 * @param Callback ロード完了時のコールバック(失敗時は nullptr)。ロード済みの場合はこの関数内で呼ばれる。
+	 * @param Priority FStreamableManager のロード優先度
+	 * @return コールバックの登録ID。ロード完了前に CancelCallback で登録解除できる。(コールバックを登録しなかった場合は 0)
+	 * @details 呼び出し側は成否にかかわらず、必ず対応する Release を呼ぶこと。
+	 */
+	uint64 Acquire(const FSoftObjectPath& Path, FOnAssetLoaded Callback = nullptr,
+				   int32 Priority = FStreamableManager::DefaultAsyncLoadPriority);
+
+	/**
+	 * @brief 参照カウントを1つ減らす。0 になったエントリは猶予時間後に解放される。
+	 */
+	void Release(const FSoftObjectPath& Path);
+
+	/**
+	 * @brief ロード完了前のコールバックを登録解除する。(参照カウントは変わらない)
+	 */
+	void CancelCallback(const FSoftObjectPath& Path, uint64 CallbackID);
+
+	/**
+	 * @brief ロード済みのアセットを返す。ロード中・未登録の場合は nullptr
+	 */
+	UObject* Find(const FSoftObjectPath& Path) const;
+	bool IsLoading(const FSoftObjectPath& Path) const;
+	int32 GetRefCount(const FSoftObjectPath& Path) const;
+	int32 Num() const { return Entries.Num(); }
+
+	/**
+	 * @brief 猶予中(参照カウント 0)のエントリを全て即座に解放する。
+	 */
+	void FlushUnreferenced();
+
+	/**
+	 * @brief 全てのエントリを解放する。(モジュール終了時用)
+	 */
+	void Shutdown();
+
+private:
+	struct FEntry
+	{
+		TSharedPtr<FStreamableHandle> Handle;
+		TWeakObjectPtr<UObject> Asset;
+		TArray<TPair<uint64, FOnAssetLoaded>> Callbacks;
+		int32 RefCount = 0;
+		double ReleasedTime = .0;
+		bool bLoading = false;
+	};
+
+	void OnLoadCompleted(FSoftObjectPath Path);
+	void Evict(const FSoftObjectPath& Path);
+	bool Tick(float DeltaTime);
+	void UpdateTicker();
+
+	TMap<FSoftObjectPath, FEntry> Entries;
+	/** 参照カウント 0 のエントリ (古い順) */
+	TArray<FSoftObjectPath> UnreferencedLRU;
+	FTSTicker::FDelegateHandle TickerHandle;
+	uint64 NextCallbackID = 1;
+};
@@ -5,6 +5,19 @@
 #include "CoreMinimal.h"
 #include "Engine/AssetManager.h"
 #include "Engine/StreamableManager.h"
+#include "Containers/Ticker.h"
+#include "RuntimeAssetCache.h"
+
+/**
+ * TRuntimeAssetPtr のロード完了コールバックを呼ぶタイミング
+ */
+enum class ERuntimeAssetCallbackTiming : uint8
+{
+	/** ロード済みの場合は LoadAsync 内で、未ロードの場合はロード完了時に呼ぶ */
+	Immediate,
+	/** ロード済みかどうかにかかわらず、常に次の Tick で呼ぶ */
+	NextTick,
+};
 
 /**
  * TRuntimeAssetPtr
@@ -13,7 +26,14 @@
  *  - LoadAsync() を呼ぶと非同期ロード
  *  - ロード完了後は Get() で即利用
  *  - ロードが終わるまで Get() は nullptr を返す
+ *  - 既にメモリ上にあるアセットは FStreamableManager を経由せずに即座に解決する (TryGetNow)
+ *  - コールバックのタイミングは SetCallbackTiming で統一できる (既定はロード済みなら即時)
  *  - このオブジェクト自身はロードしたAssetのGC保護をしないので注意
+ *  - bUseSharedCache を有効にした場合は FRuntimeAssetCache 経由でロードする
+ *    同じパスのロード要求はまとめられ、Reset() まで(猶予時間を含め)アセットは GC されない
+ *  - ロード中の状態はヒープ上の FLoadState に置き、コールバックは弱参照 + 世代番号で FLoadState を参照する
+ *    Reset() / 破棄後に遅れて届いたコールバックは何もしない
+ *    このオブジェクト自身へのポインタはどこにも保持しないので、ムーブや TArray 内での再配置が可能
  */
 template<typename AssetType>
 class LIQUID_API TRuntimeAssetPtr
@@ -23,35 +43,111 @@ public:
 	using ThisType = TRuntimeAssetPtr<AssetType>;
 
 	TRuntimeAssetPtr() =default;
-	explicit TRuntimeAssetPtr(const TSoftObjectPtr<AssetType>& SoftPtr)
-		: SoftPtr(SoftPtr){}
+	explicit TRuntimeAssetPtr(const TSoftObjectPtr<AssetType>& SoftPtr, bool bInUseSharedCache = false)
+		: SoftPtr(SoftPtr), bUseSharedCache(bInUseSharedCache){}
 	~TRuntimeAssetPtr() { Reset(); }
 
+	//note: コピーするとロード中の要求・共有キャッシュの参照が二重に解放されるのでムーブのみ
+	TRuntimeAssetPtr(const ThisType&) = delete;
+	ThisType& operator=(const ThisType&) = delete;
+	TRuntimeAssetPtr(ThisType&& Other)
+		: SoftPtr(MoveTemp(Other.SoftPtr))
+		, CachedAssetPtr(Other.CachedAssetPtr)
+		, LoadState(MoveTemp(Other.LoadState))
+		, CallbackTiming(Other.CallbackTiming)
+		, bUseSharedCache(Other.bUseSharedCache)
+	{
+		Other.CachedAssetPtr.Reset();
+	}
+	ThisType& operator=(ThisType&& Other)
+	{
+		if (this != &Other)
+		{
+			Reset();
+			SoftPtr = MoveTemp(Other.SoftPtr);
+			CachedAssetPtr = Other.CachedAssetPtr;
+			LoadState = MoveTemp(Other.LoadState);
+			CallbackTiming = Other.CallbackTiming;
+			bUseSharedCache = Other.bUseSharedCache;
+			Other.CachedAssetPtr.Reset();
+		}
+		return *this;
+	}
+
 	void SetSoftPtr(const TSoftObjectPtr<AssetType>& InSoftPtr)
 	{
 		Reset();
+		//別のアセットに変わる場合は前のアセットを Get() で返さないようにする
+		if (SoftPtr != InSoftPtr)
+		{
+			CachedAssetPtr.Reset();
+			LoadState.Reset();
+		}
 		SoftPtr = InSoftPtr;
 	}
 
 	AssetType* Get() const
 	{
-		return CachedAssetPtr.Get();
+		if (AssetType* Cached = CachedAssetPtr.Get())
+		{
+			return Cached;
+		}
+		return LoadState.IsValid() ? LoadState->Asset.Get() : nullptr;
 	}
+	const TSoftObjectPtr<AssetType>& GetSoftPtr() const { return SoftPtr; }
 
+	/**
+	 * @brief アセットが既にメモリ上にあれば返す。ロード要求・アロケーションは行わない。
+	 * @details LoadAsync を呼んでいなくても、他でロード済みであれば取得してキャッシュする。
+	 */
+	AssetType* TryGetNow() const
+	{
+		if (AssetType* Loaded = Get())
+		{
+			return Loaded;
+		}
+		if (SoftPtr.IsNull())
+		{
+			return nullptr;
+		}
+		AssetType* Resident = SoftPtr.Get();
+		CachedAssetPtr = Resident;
+		return Resident;
+	}
+
+	void SetCallbackTiming(ERuntimeAssetCallbackTiming InCallbackTiming) { CallbackTiming = InCallbackTiming; }
+	ERuntimeAssetCallbackTiming GetCallbackTiming() const { return CallbackTiming; }
+
+	void SetUseSharedCache(bool bInUseSharedCache)
+	{
+		Reset();
+		bUseSharedCache = bInUseSharedCache;
+	}
+	bool IsUsingSharedCache() const { return bUseSharedCache; }
+
+	/**
+	 * @brief ロード中の要求・未実行のコールバックを全て取り消す。
+	 * @details 世代番号を進めるので、既に発行済みのコールバックが後から届いても無視される。
+	 */
 	void Reset()
 	{
-		//CancelHandle()でCallbackが呼ばれることがあるようなので先に無効化しておく(GPT:o3が5.3以降で報告ありと言ってきたので一応)
-		LoadedCallback = nullptr;
-		if (LoadingHandle.IsValid())
+		if (LoadState.IsValid())
 		{
-			LoadingHandle->CancelHandle();
+			//ロード済みのアセットは Reset 後も Get() できるようにしておく(従来通り)
+			if (!CachedAssetPtr.IsValid())
+			{
+				CachedAssetPtr = LoadState->Asset;
+			}
+			LoadState->Cancel();
 		}
-		LoadingHandle.Reset();
 		//CachedAssetPtr.Reset();
 		//SoftPtr.Reset();
 	}
-	bool IsLoaded()const{return CachedAssetPtr.IsValid();}
-	bool IsLoading()const{return LoadingHandle.IsValid() && !LoadingHandle->HasLoadCompleted();}
+	bool IsLoaded()const{return TryGetNow() != nullptr;}
+	bool IsLoading()const
+	{
+		return LoadState.IsValid() && LoadState->IsLoading();
+	}
 
 	void LoadAsync(TFunction<void(AssetType*)> Callback = nullptr,
 				   int32 Priority = FStreamableManager::DefaultAsyncLoadPriority)
@@ -61,12 +157,25 @@ public:
 			return;
 		}
 
-		if (IsLoaded())
+		//共有キャッシュは参照カウントを取るために Acquire が必要なので、取得済みの場合のみ
+		const bool bSharedAcquired = LoadState.IsValid() && LoadState->bSharedAcquired;
+		const bool bCanResolveNow = bUseSharedCache ? bSharedAcquired && IsLoaded() : IsLoaded();
+		if (bCanResolveNow)
 		{
-			if (Callback)
+			if (!Callback)
 			{
-				Callback(CachedAssetPtr.Get());
+				return;
 			}
+			//ロード済み・即時コールバックの場合は FLoadState を確保しない
+			if (CallbackTiming == ERuntimeAssetCallbackTiming::Immediate)
+			{
+				Callback(TryGetNow());
+				return;
+			}
+			FLoadState& State = GetOrCreateLoadState();
+			State.Asset = TryGetNow();
+			State.LoadedCallback = MoveTemp(Callback);
+			State.DispatchLoadedCallback();
 			return;
 		}
 		if (IsLoading())
@@ -79,55 +188,220 @@ public:
 			return;
 		}
 
-		LoadedCallback = Callback;
+		FLoadState& State = GetOrCreateLoadState();
+		State.LoadedCallback = MoveTemp(Callback);
+
+		if (bUseSharedCache)
+		{
+			State.LoadSharedAsync(Priority);
+			return;
+		}
 		
 		FStreamableManager& Manager = UAssetManager::GetStreamableManager();
-		LoadingHandle = Manager.RequestAsyncLoad(
+		const TSharedPtr<FStreamableHandle> Handle = Manager.RequestAsyncLoad(
 			SoftPtr.ToSoftObjectPath(),
-			FStreamableDelegate::CreateLambda([this, Callback]()
+			FStreamableDelegate::CreateLambda([WeakState = State.AsWeak(), Generation = State.Generation]()
 			{
-				this->OnAsyncLoadCompleted();
+				if (const TSharedPtr<FLoadState> Pinned = FLoadState::Resolve(WeakState, Generation))
+				{
+					Pinned->OnAsyncLoadCompleted();
+				}
 			}),
 			Priority);
 		//アセットがすでにロード済だった場合でHandleがCompleteになっている時の対策
-		if (LoadingHandle && LoadingHandle->HasLoadCompleted())
+		if (Handle && !Handle->HasLoadCompleted())
 		{
-			LoadingHandle.Reset();         
+			State.LoadingHandle = Handle;
 		}
 
 	}
 
 private:
-	void OnAsyncLoadCompleted()
+	/**
+	 * ロード中の状態。コールバックからは TWeakPtr + 世代番号でのみ参照する。
+	 */
+	struct FLoadState : public TSharedFromThis<FLoadState>
 	{
-		if (SoftPtr.IsNull())
+		explicit FLoadState(const TSoftObjectPtr<AssetType>& InSoftPtr, ERuntimeAssetCallbackTiming InCallbackTiming)
+			: SoftPtr(InSoftPtr), CallbackTiming(InCallbackTiming) {}
+		~FLoadState() { Cancel(); }
+
+		/**
+		 * @return 世代が一致する場合のみ有効なポインタを返す。(Reset / 破棄後は nullptr)
+		 * @details コールバック内で持ち主が破棄されても良いように、呼び出し中は返り値で保持しておく。
+		 */
+		static TSharedPtr<FLoadState> Resolve(const TWeakPtr<FLoadState>& WeakState, uint32 Generation)
 		{
-			UE_LOG(LogTemp, Warning,
-				   TEXT("[TRuntimeAssetPtr] OnAsyncLoadCompleted called after Reset/Cancellation – ignored."));
-			return;
+			TSharedPtr<FLoadState> Pinned = WeakState.Pin();
+			if (!Pinned.IsValid() || Pinned->Generation != Generation)
+			{
+				return nullptr;
+			}
+			return Pinned;
 		}
-		auto Result = SoftPtr.Get();
-		bool IsSuccessful = SoftPtr.IsValid() && Result != nullptr;
-		if (!IsSuccessful)
+
+		bool IsLoading() const
 		{
-			UE_LOG(LogTemp, Error,
-				   TEXT("[TRuntimeAssetPtr] Failed to load asset: %s"),
-				   *SoftPtr.ToString());
+			if (bSharedAcquired)
+			{
+				return FRuntimeAssetCache::Get().IsLoading(SoftPtr.ToSoftObjectPath());
+			}
+			return LoadingHandle.IsValid() && !LoadingHandle->HasLoadCompleted();
 		}
 
-		CachedAssetPtr = IsSuccessful ? Result : nullptr;
-		//ロードが終了したので破棄
-		LoadingHandle.Reset();
-		if (Result && LoadedCallback)
+		void Cancel()
+		{
+			++Generation;
+			if (bSharedAcquired)
+			{
+				FRuntimeAssetCache& Cache = FRuntimeAssetCache::Get();
+				Cache.CancelCallback(SoftPtr.ToSoftObjectPath(), SharedCallbackID);
+				Cache.Release(SoftPtr.ToSoftObjectPath());
+				SharedCallbackID = 0;
+				bSharedAcquired = false;
+			}
+			//CancelHandle()でCallbackが呼ばれることがあるようなので先に無効化しておく(GPT:o3が5.3以降で報告ありと言ってきたので一応)
+			LoadedCallback = nullptr;
+			DeferredCallbacks.Reset();
+			if (DeferredCallbackHandle.IsValid())
+			{
+				FTSTicker::GetCoreTicker().RemoveTicker(DeferredCallbackHandle);
+				DeferredCallbackHandle.Reset();
+			}
+			if (LoadingHandle.IsValid())
+			{
+				LoadingHandle->CancelHandle();
+			}
+			LoadingHandle.Reset();
+		}
+
+		/**
+		 * @brief CallbackTiming に従ってロード完了コールバックを呼ぶ。
+		 */
+		void DispatchLoadedCallback()
+		{
+			if (!LoadedCallback)
+			{
+				return;
+			}
+			if (CallbackTiming == ERuntimeAssetCallbackTiming::Immediate)
+			{
+				//コールバック内で再度 LoadAsync されても良いように取り出してから呼ぶ
+				const TFunction<void(AssetType*)> Callback = MoveTemp(LoadedCallback);
+				LoadedCallback = nullptr;
+				Callback(Asset.Get());
+				return;
+			}
+			DeferredCallbacks.Add(MoveTemp(LoadedCallback));
+			LoadedCallback = nullptr;
+			if (!DeferredCallbackHandle.IsValid())
+			{
+				DeferredCallbackHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(
+					[WeakState = this->AsWeak(), CurrentGeneration = Generation](float)
+					{
+						if (const TSharedPtr<FLoadState> Pinned = Resolve(WeakState, CurrentGeneration))
+						{
+							Pinned->DeferredCallbackHandle.Reset();
+							const TArray<TFunction<void(AssetType*)>> Callbacks = MoveTemp(Pinned->DeferredCallbacks);
+							//次の Tick までに GC された場合は呼ばない
+							if (AssetType* LoadedAsset = Pinned->Asset.Get())
+							{
+								for (const TFunction<void(AssetType*)>& Callback : Callbacks)
+								{
+									//コールバック内で Reset / 破棄された場合は残りを呼ばない
+									if (Pinned->Generation != CurrentGeneration)
+									{
+										break;
+									}
+									Callback(LoadedAsset);
+								}
+							}
+						}
+						return false;
+					}));
+			}
+		}
+
+		void LoadSharedAsync(int32 Priority)
+		{
+			//ロードに失敗した後の再要求。前回の参照は返しておく
+			if (bSharedAcquired)
+			{
+				FRuntimeAssetCache::Get().Release(SoftPtr.ToSoftObjectPath());
+			}
+			//Acquire 内でコールバックが呼ばれることがあるので先にフラグを立てる
+			bSharedAcquired = true;
+			SharedCallbackID = 0;
+			const uint64 CallbackID = FRuntimeAssetCache::Get().Acquire(
+				SoftPtr.ToSoftObjectPath(),
+				[WeakState = this->AsWeak(), CurrentGeneration = Generation](UObject*)
+				{
+					if (const TSharedPtr<FLoadState> Pinned = Resolve(WeakState, CurrentGeneration))
+					{
+						Pinned->SharedCallbackID = 0;
+						Pinned->OnAsyncLoadCompleted();
+					}
+				},
+				Priority);
+			//ロード済みの場合はコールバック呼び出し済みなので登録IDは 0
+			SharedCallbackID = CallbackID;
+		}
+
+		void OnAsyncLoadCompleted()
+		{
+			auto Result = SoftPtr.Get();
+			bool IsSuccessful = SoftPtr.IsValid() && Result != nullptr;
+			if (!IsSuccessful)
+			{
+				UE_LOG(LogTemp, Error,
+					   TEXT("[TRuntimeAssetPtr] Failed to load asset: %s"),
+					   *SoftPtr.ToString());
+			}
+
+			Asset = IsSuccessful ? Result : nullptr;
+			//ロードが終了したので破棄
+			LoadingHandle.Reset();
+			if (!Result)
+			{
+				LoadedCallback = nullptr;
+				return;
+			}
+			DispatchLoadedCallback();
+		}
+
+		TSoftObjectPtr<AssetType> SoftPtr{};
+		TWeakObjectPtr<AssetType> Asset{};
+		TSharedPtr<FStreamableHandle> LoadingHandle{};
+		TFunction<void(AssetType*)> LoadedCallback{nullptr};
+		TArray<TFunction<void(AssetType*)>> DeferredCallbacks{}; // NextTick で呼ぶコールバック
+		FTSTicker::FDelegateHandle DeferredCallbackHandle{};
+		ERuntimeAssetCallbackTiming CallbackTiming = ERuntimeAssetCallbackTiming::Immediate;
+		uint64 SharedCallbackID = 0;
+		uint32 Generation = 0;
+		bool bSharedAcquired = false;
+	};
+
+	/**
+	 * @brief FLoadState を取得する。無ければ確保し、あれば前回の要求を取り消して再利用する。
+	 */
+	FLoadState& GetOrCreateLoadState()
+	{
+		if (!LoadState.IsValid() || LoadState->SoftPtr != SoftPtr)
+		{
+			LoadState = MakeShared<FLoadState>(SoftPtr, CallbackTiming);
+		}
+		else
 		{
-			LoadedCallback(CachedAssetPtr.Get());
+			//失敗後の再要求では共有キャッシュの参照を LoadSharedAsync 内で返すので、ここでは取り消さない
+			LoadState->CallbackTiming = CallbackTiming;
 		}
-		LoadedCallback = nullptr;
+		return *LoadState;
 	}
 
 private:
 	TSoftObjectPtr<AssetType> SoftPtr{};
-	TWeakObjectPtr<AssetType> CachedAssetPtr{}; // Note: GCから守る強参照は不要：呼び出し側(このオブジェクトの保持者が持つ)
-	TSharedPtr<FStreamableHandle> LoadingHandle{};
-	TFunction<void(AssetType*)> LoadedCallback{nullptr};
+	mutable TWeakObjectPtr<AssetType> CachedAssetPtr{}; // Note: GCから守る強参照は不要：呼び出し側(このオブジェクトの保持者が持つ)
+	TSharedPtr<FLoadState> LoadState{};
+	ERuntimeAssetCallbackTiming CallbackTiming = ERuntimeAssetCallbackTiming::Immediate;
+	bool bUseSharedCache = false;
 };
@@ -39,7 +39,9 @@ public class liquid : ModuleRules
 				"Slate",
 				"SlateCore",
 				"RenderCore", 
-				"Niagara"
+				"RHI",
+				"Niagara",
+				"Json"
 				// ... add private dependencies that you statically link with here ...	
 			}
 			);